@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef DIFFICULTY_H
+#define DIFFICULTY_H
+
+#include "sudoku.h"
+
+/**
+ * @brief Grades a playable board and prints its difficulty.
+ *
+ * Solves a copy of the board with the constraint propagation solver and
+ * grades it from the hardest technique it needed, how often the techniques
+ * made progress and how many times the search had to guess.
+ *
+ * @param sudoku Pointer to the Sudoku puzzle to grade
+ */
+void gradeSudoku(struct Sudoku *sudoku);
+
+#endif /* DIFFICULTY_H */
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sudoku.h"
+
+/* First bytes of a pool file */
+#define POOL_MAGIC "SDKPOOL1"
+
+/* Biggest grids a pool holds, a cell takes one byte */
+#define POOL_MAX_SIZE 255
+
+/**
+ * @struct PoolHeader
+ * @brief Header at the start of a pool file
+ *
+ * The complete grids follow it, one byte per cell in row order, so a grid
+ * of size n takes n * n bytes. The integers are in the byte order of the
+ * machine that built the pool.
+ */
+struct PoolHeader {
+	char magic[8];		/* POOL_MAGIC, without the terminator */
+	uint32_t size;		/* Size of the grids */
+	uint32_t reserved;	/* Zero */
+	uint64_t count;		/* Number of grids */
+};
+
+/**
+ * @struct GridPool
+ * @brief A pool file mapped in memory
+ */
+struct GridPool {
+	void *map;		/* The whole file */
+	size_t length;		/* Length of the mapping */
+	const unsigned char *grids;	/* First cell of the first grid */
+	int size;		/* Size of the grids */
+	uint64_t count;		/* Number of grids */
+};
+
+/**
+ * @brief Writes the header of a pool file.
+ *
+ * @param file The file, open for writing at its start
+ * @param size Size of the grids
+ * @param count Number of grids that will follow
+ * @return 0 on success, -1 on a write error
+ */
+int writePoolHeader(FILE *file, int size, uint64_t count);
+
+/**
+ * @brief Appends a complete grid to a pool file.
+ *
+ * @param file The file, after its header
+ * @param sudoku The complete grid, of the size in the header
+ * @return 0 on success, -1 on a write error
+ */
+int writePoolGrid(FILE *file, struct Sudoku *sudoku);
+
+/**
+ * @brief Maps a pool file in memory.
+ *
+ * Only the pages of the grids drawn are read, so opening a pool costs the
+ * same whatever its size.
+ *
+ * @param filename Name of the pool file
+ * @param size Size the grids must have
+ * @return The pool, NULL if the file can't be mapped or doesn't hold grids
+ *         of that size
+ */
+struct GridPool *openGridPool(const char *filename, int size);
+
+/**
+ * @brief Unmaps a pool and frees it. NULL is ignored.
+ *
+ * @param pool The pool to close
+ */
+void closeGridPool(struct GridPool *pool);
+
+/**
+ * @brief Fills the grid with a random grid of the pool.
+ *
+ * The grid is drawn with rand() and transformed with transformSudoku(), so
+ * even a small pool gives varied grids.
+ *
+ * @param pool The pool to draw from
+ * @param sudoku Pointer to the Sudoku puzzle to fill
+ * @return 0 on success, -1 if the grid drawn isn't a valid solution
+ */
+int drawFromGridPool(struct GridPool *pool, struct Sudoku *sudoku);
+
+#endif /* POOL_H */
@@ -26,6 +26,70 @@ struct ExactCover {
 	int count;		/* Count of nodes to deallocate */
 };
 
+/**
+ * @struct CoverMatrix
+ * @brief Exact cover structure of one Sudoku size, built once and reused
+ *
+ * Unlike ExactCover it keeps no dense matrix: the column headers and the
+ * four nodes of each of the size^3 candidate rows live in a single array.
+ * Every search selects the givens of a puzzle, then takes them back, so
+ * the structure is ready for the next puzzle of the same size.
+ */
+struct CoverMatrix {
+	struct node *head;	/* Head of the toroidal doubly linked list */
+	struct node *nodes;	/* Head, column headers, then the rows */
+	struct node **rows;	/* First node of each row, by (cell, value) */
+	struct node **selected;	/* Rows of the givens, in selection order */
+	char *covered;		/* Columns covered by the givens */
+	int size;		/* Size of the Sudoku puzzle */
+};
+
+/**
+ * @brief Builds the exact cover structure for puzzles of a size.
+ *
+ * @param size The size of the Sudoku puzzles
+ * @return Pointer to the structure, NULL if allocation fails
+ */
+struct CoverMatrix *initCoverMatrix(int size);
+
+/**
+ * @brief Destroys a CoverMatrix structure and frees memory.
+ *
+ * @param matrix The structure to destroy
+ */
+void destroyCoverMatrix(struct CoverMatrix *matrix);
+
+/**
+ * @brief Counts the solutions of a puzzle, stopping at a limit.
+ *
+ * Counting up to two is enough to tell a unique puzzle from one with no
+ * solution or several, without exploring the rest of the search tree.
+ *
+ * @param matrix The exact cover structure for the size of the puzzle
+ * @param sudoku The puzzle
+ * @param limit Number of solutions after which the search stops
+ * @return The number of solutions, at most limit
+ */
+int countSolutions(struct CoverMatrix *matrix, struct Sudoku *sudoku,
+		   int limit);
+
+/**
+ * @brief Looks for a solution that puts another value in an empty cell.
+ *
+ * The row placing value in the cell is taken out of the structure, so the
+ * search only has to find one solution, and usually fails early when
+ * there is none.
+ *
+ * @param matrix The exact cover structure for the size of the puzzle
+ * @param sudoku The puzzle, with the cell empty
+ * @param row Row of the cell
+ * @param col Column of the cell
+ * @param value The value the cell must not take
+ * @return 1 if such a solution exists, 0 otherwise
+ */
+int hasOtherSolution(struct CoverMatrix *matrix, struct Sudoku *sudoku,
+		     int row, int col, int value);
+
 /**
  * @brief Initializes an ExactCover structure for the Sudoku puzzle.
  *
@@ -16,6 +16,16 @@ struct Sudoku {
 	int squareRootOfSize;	/* Square root of size (e.g., 3, 4, 5) */
 };
 
+/**
+ * @brief Reads the monotonic wall clock.
+ *
+ * Used for every reported time. clock() would add up the CPU time of the
+ * threads removing clues.
+ *
+ * @return The time in seconds, from an arbitrary origin
+ */
+double wallTime(void);
+
 /**
  * @brief Initializes a new Sudoku puzzle of the specified size.
  *
@@ -34,24 +44,46 @@ void displaySudoku(struct Sudoku *sudoku);
 /**
  * @brief Inserts the first row of the Sudoku grid with a random permutation.
  *
+ * The permutation is drawn with rand(), seeded by the caller.
+ *
  * @param sudoku Pointer to the Sudoku puzzle to modify
  */
 void insertFirstLine(struct Sudoku *sudoku);
 
 /**
- * @brief Solves the Sudoku puzzle using Algorithm X.
+ * @brief Applies a random symmetry to a complete grid.
+ *
+ * The digits are relabeled, rows are shuffled within their band and bands
+ * among themselves, the same goes for columns and stacks, and the grid is
+ * transposed half of the time. Every step keeps the grid valid. The
+ * symmetry is drawn with rand(), seeded by the caller.
  *
- * @param sudoku Pointer to the Sudoku puzzle to solve
- * @return 1 if the puzzle is solved, 0 otherwise
+ * @param sudoku Pointer to the complete Sudoku grid to transform
  */
-int hasUniqueSolution(struct Sudoku *sudoku, struct Sudoku *solution);
+void transformSudoku(struct Sudoku *sudoku);
+
+/**
+ * @brief Fills the grid with a complete solution without searching.
+ *
+ * Starts from the grid whose rows are the first one shifted by a box width
+ * within a band, and by one from band to band, and transforms it with
+ * transformSudoku(). The grids are all equivalent to the pattern.
+ *
+ * @param sudoku Pointer to the Sudoku puzzle to fill
+ */
+void fillFromPattern(struct Sudoku *sudoku);
 
 /**
  * @brief Remove the numbers from the board until we reach minimal solution.
  *
+ * The cells are tried in an order drawn with rand(), several at once when
+ * there are several threads. The puzzle only depends on the seed of
+ * rand(), not on the number of threads.
+ *
  * @param sudoku Pointer to the Sudoku puzzle to properly generate
+ * @param n_threads Number of cells tested at the same time
  */
-void removeNumbers(struct Sudoku *sudoku);
+void removeNumbers(struct Sudoku *sudoku, int n_threads);
 
 /**
  * @brief Saves the Sudoku grid to a file named output.txt
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include <stdio.h>
+
+#include "../include/difficulty.h"
+#include "../../solver/constraint_propagation/include/grade.h"
+#include "../../solver/constraint_propagation/include/sudoku_utils.h"
+
+/* Function for grading the playable board */
+void gradeSudoku(struct Sudoku *sudoku)
+{
+	int n = sudoku->size;
+
+	if (n > MAX_SIZE) {
+		printf("\nBoards bigger than %d can't be graded.\n", MAX_SIZE);
+		return;
+	}
+
+	// The solver works in place, grade a copy
+	int **grid = create_grid(n);
+	struct solver_context *context =
+		create_solver_context(n, DEFAULT_FISH_SIZE);
+	if (grid == NULL || context == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory for grading\n");
+		free_solver_context(context);
+		if (grid != NULL)
+			free_grid(grid, n);
+		return;
+	}
+
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			grid[i][j] = sudoku->grid[i][j];
+
+	double start_time = wallTime();
+	struct puzzle_grade grade;
+
+	sudoku_solver(context, grid);
+	read_grade(context, &grade);
+
+	double grading_time = wallTime() - start_time;
+
+	printf("\nDifficulty: %s (score %lu, hardest technique %s, %lu branch points)\n",
+	       difficulty_name(grade.difficulty), grade.score,
+	       grade.hardest >= 0 ? technique_name(grade.hardest) : "none",
+	       grade.branches);
+	printf("Graded in %.6f seconds.\n", grading_time);
+
+	free_solver_context(context);
+	free_grid(grid, n);
+}
@@ -3,21 +3,61 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "../include/sudoku.h"
 #include "../include/solver.h"
+#include "../include/difficulty.h"
+#include "../include/pool.h"
 
 int main(int argc, char **argv)
 {
+	int n_threads = 1;
+	unsigned int seed = time(NULL);
+	const char *fill = "solver";
+	const char *pool_filename = NULL;
+	int arg;
+
+	// Options come before the size
+	for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-j") == 0)
+			n_threads = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-s") == 0)
+			seed = strtoul(argv[arg + 1], NULL, 10);
+		else if (strcmp(argv[arg], "-f") == 0)
+			fill = argv[arg + 1];
+		else if (strcmp(argv[arg], "-p") == 0)
+			pool_filename = argv[arg + 1];
+		else
+			break;
+	}
+
 	// Check if we have the right number of arguments
-	if (argc != 2) {
-		printf("Usage: %s <size>\n", argv[0]);
+	if (argc - arg != 1) {
+		printf("Usage: %s [-j threads] [-s seed] [-f solver|pattern|pool] [-p pool file] <size>\n",
+		       argv[0]);
+		return 1;
+	}
+
+	if (n_threads < 1) {
+		printf("Threads must be a positive integer.\n");
+		return 1;
+	}
+
+	if (strcmp(fill, "solver") != 0 && strcmp(fill, "pattern") != 0 &&
+	    strcmp(fill, "pool") != 0) {
+		printf("Fill mode must be solver, pattern or pool.\n");
+		return 1;
+	}
+
+	if ((strcmp(fill, "pool") == 0) != (pool_filename != NULL)) {
+		printf("The pool fill mode goes with a pool file.\n");
 		return 1;
 	}
 
 	// Parse the size from command line
-	int n = atoi(argv[1]);
+	int n = atoi(argv[arg]);
 
 	// Check if n is a positive number
 	if (n <= 0) {
@@ -35,6 +75,15 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	// Map the pool before anything else, there is nothing to do without it
+	struct GridPool *pool = NULL;
+
+	if (strcmp(fill, "pool") == 0) {
+		pool = openGridPool(pool_filename, n);
+		if (pool == NULL)
+			return 1;
+	}
+
 	// Initialize the Sudoku grid
 	printf("Initializing Sudoku grid of size %dx%d...\n", n, n);
 	struct Sudoku *sudoku = initSudoku(n);
@@ -44,45 +93,66 @@ int main(int argc, char **argv)
 	displaySudoku(sudoku);
 	printf("\n\n\n");
 
-	// Start timing the computation
-	clock_t start_time = clock();
+	// The same seed gives the same puzzle, whatever the number of threads
+	printf("Seed: %u\n\n", seed);
+	srand(seed);
 
-	// Fill the first row with a random permutation
-	insertFirstLine(sudoku);
-
-	// Generate a complete Sudoku grid
-	printf("Generating a complete Sudoku grid...\n\n");
-	SudokuSolver(sudoku);
+	// Start timing the computation
+	double start_time = wallTime();
+
+	if (pool != NULL) {
+		// Draw a grid of the pool under a random symmetry
+		printf("Drawing a complete Sudoku grid from %s...\n\n",
+		       pool_filename);
+		if (drawFromGridPool(pool, sudoku) != 0) {
+			fprintf(stderr, "Error: %s holds an invalid grid\n",
+				pool_filename);
+			closeGridPool(pool);
+			destroySudoku(sudoku);
+			return 1;
+		}
+	} else if (strcmp(fill, "pattern") == 0) {
+		// Shuffle a grid built from the shifted pattern
+		printf("Generating a complete Sudoku grid from a pattern...\n\n");
+		fillFromPattern(sudoku);
+	} else {
+		// Fill the first row with a random permutation
+		insertFirstLine(sudoku);
+
+		// Generate a complete Sudoku grid
+		printf("Generating a complete Sudoku grid...\n\n");
+		SudokuSolver(sudoku);
+	}
 	printf("The proposed grid:\n");
 	displaySudoku(sudoku);
 
-	clock_t mid_time = clock();
-	double solving_time =
-		(double)(mid_time - start_time) / CLOCKS_PER_SEC;
+	double mid_time = wallTime();
+	double solving_time = mid_time - start_time;
 	printf("\nComplete board generated in %.6f seconds.\n", solving_time);
 
 	printf("\n\n\n");
 	printf("Now generating a playable board from the given solution...\n\n");
-	removeNumbers(sudoku);
+	removeNumbers(sudoku, n_threads);
 	printf("The playable grid:\n");
 	displaySudoku(sudoku);
 
 	// End timing
-	clock_t end_time = clock();
+	double end_time = wallTime();
 
-	double generating_time =
-		(double)(end_time - mid_time) / CLOCKS_PER_SEC;
+	double generating_time = end_time - mid_time;
 	printf("\nGenerating playable board completed in %.6f seconds.\n", generating_time);
 
-	double computation_time =
-		(double)(end_time - start_time) / CLOCKS_PER_SEC;
+	double computation_time = end_time - start_time;
 
 	printf("\nTotal computation completed in %.6f seconds.\n", computation_time);
 
+	gradeSudoku(sudoku);
+
 	// Save the Sudoku grid to a file
 	saveSudokuToFile(sudoku);
 
 	// Deallocate memory
+	closeGridPool(pool);
 	destroySudoku(sudoku);
 	return 0;
 }
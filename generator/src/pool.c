@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/pool.h"
+
+/* Function for writing the header of a pool file */
+int writePoolHeader(FILE *file, int size, uint64_t count)
+{
+	struct PoolHeader header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, POOL_MAGIC, sizeof(header.magic));
+	header.size = size;
+	header.count = count;
+
+	return fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+}
+
+/* Function for appending a grid to a pool file */
+int writePoolGrid(FILE *file, struct Sudoku *sudoku)
+{
+	int size = sudoku->size;
+
+	for (int i = 0; i < size; i++)
+		for (int j = 0; j < size; j++)
+			if (fputc(sudoku->grid[i][j], file) == EOF)
+				return -1;
+
+	return 0;
+}
+
+/* Function for mapping a pool file */
+struct GridPool *openGridPool(const char *filename, int size)
+{
+	int fd = open(filename, O_RDONLY);
+	struct stat st;
+
+	if (fd < 0) {
+		fprintf(stderr, "Error: Could not open %s\n", filename);
+		return NULL;
+	}
+	if (fstat(fd, &st) != 0 ||
+	    (size_t)st.st_size < sizeof(struct PoolHeader)) {
+		fprintf(stderr, "Error: %s is not a grid pool\n", filename);
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid once the file is closed
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map %s\n", filename);
+		return NULL;
+	}
+
+	const struct PoolHeader *header = map;
+	size_t cells = (size_t)size * size;
+
+	if (memcmp(header->magic, POOL_MAGIC, sizeof(header->magic)) != 0) {
+		fprintf(stderr, "Error: %s is not a grid pool\n", filename);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	if (header->size != (uint32_t)size) {
+		fprintf(stderr, "Error: %s holds %ux%u grids, not %dx%d\n",
+			filename, header->size, header->size, size, size);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	if (header->count == 0 ||
+	    header->count > (st.st_size - sizeof(*header)) / cells) {
+		fprintf(stderr, "Error: %s is truncated\n", filename);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	struct GridPool *pool = malloc(sizeof(struct GridPool));
+
+	if (pool == NULL) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	pool->map = map;
+	pool->length = st.st_size;
+	pool->grids = (const unsigned char *)map + sizeof(*header);
+	pool->size = size;
+	pool->count = header->count;
+
+	return pool;
+}
+
+/* Function for unmapping a pool */
+void closeGridPool(struct GridPool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	munmap(pool->map, pool->length);
+	free(pool);
+}
+
+/* Function for checking that every row, column and box holds each value */
+static int isCompleteGrid(struct Sudoku *sudoku)
+{
+	int size = sudoku->size;
+	int box_size = sudoku->squareRootOfSize;
+	char *seen = malloc(3 * size * (size + 1));
+	int valid = seen != NULL;
+
+	if (seen != NULL)
+		memset(seen, 0, 3 * size * (size + 1));
+
+	for (int i = 0; i < size && valid; i++) {
+		for (int j = 0; j < size && valid; j++) {
+			int value = sudoku->grid[i][j];
+			int box = (i / box_size) * box_size + j / box_size;
+
+			if (value < 1 || value > size ||
+			    seen[i * (size + 1) + value]++ ||
+			    seen[(size + j) * (size + 1) + value]++ ||
+			    seen[(2 * size + box) * (size + 1) + value]++)
+				valid = 0;
+		}
+	}
+
+	free(seen);
+	return valid;
+}
+
+/* Function for drawing a grid from the pool */
+int drawFromGridPool(struct GridPool *pool, struct Sudoku *sudoku)
+{
+	int size = pool->size;
+
+	// rand() alone can't reach past RAND_MAX grids
+	uint64_t index = ((uint64_t)rand() * ((uint64_t)RAND_MAX + 1) +
+			  rand()) % pool->count;
+	const unsigned char *grid = pool->grids + index * size * size;
+
+	for (int i = 0; i < size; i++)
+		for (int j = 0; j < size; j++)
+			sudoku->grid[i][j] = grid[i * size + j];
+
+	// A damaged file must not reach the relabeling or the clue removal
+	if (!isCompleteGrid(sudoku))
+		return -1;
+
+	transformSudoku(sudoku);
+	return 0;
+}
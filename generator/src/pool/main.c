@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../include/pool.h"
+#include "../../include/solver.h"
+#include "../../include/sudoku.h"
+
+int main(int argc, char **argv)
+{
+	unsigned int seed = time(NULL);
+	int arg;
+
+	// Options come before the size
+	for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-s") == 0)
+			seed = strtoul(argv[arg + 1], NULL, 10);
+		else
+			break;
+	}
+
+	// Check if we have the right number of arguments
+	if (argc - arg != 3) {
+		printf("Usage: %s [-s seed] <size> <count> <pool file>\n",
+		       argv[0]);
+		return 1;
+	}
+
+	int n = atoi(argv[arg]);
+	uint64_t count = strtoull(argv[arg + 1], NULL, 10);
+	const char *filename = argv[arg + 2];
+	int sqrt_n = (int)sqrt(n);
+
+	if (n <= 0 || n > POOL_MAX_SIZE || sqrt_n * sqrt_n != n) {
+		printf("Size must be a perfect square up to %d.\n",
+		       POOL_MAX_SIZE);
+		return 1;
+	}
+
+	if (count == 0) {
+		printf("Count must be a positive integer.\n");
+		return 1;
+	}
+
+	FILE *file = fopen(filename, "wb");
+
+	if (file == NULL) {
+		fprintf(stderr, "Error: Could not open %s for writing\n",
+			filename);
+		return 1;
+	}
+
+	struct Sudoku *sudoku = initSudoku(n);
+	int failed = writePoolHeader(file, n, count) != 0;
+
+	printf("Seed: %u\n", seed);
+	srand(seed);
+
+	// Every grid is searched for from its own random first row
+	for (uint64_t k = 0; k < count && !failed; k++) {
+		for (int i = 0; i < n; i++)
+			memset(sudoku->grid[i], 0, n * sizeof(int));
+		insertFirstLine(sudoku);
+		if (!SudokuSolver(sudoku) || writePoolGrid(file, sudoku) != 0)
+			failed = 1;
+
+		if ((k + 1) % 1000 == 0 || k + 1 == count)
+			printf("Generated %llu/%llu grids\n",
+			       (unsigned long long)(k + 1),
+			       (unsigned long long)count);
+	}
+
+	if (fclose(file) != 0)
+		failed = 1;
+	destroySudoku(sudoku);
+
+	if (failed) {
+		fprintf(stderr, "Error: Could not build %s\n", filename);
+		remove(filename);
+		return 1;
+	}
+
+	printf("Pool saved to %s\n", filename);
+	return 0;
+}
@@ -9,6 +9,219 @@
 #include "../include/sudoku.h"
 #include "../include/Dancing-Links/dancing-links.h"
 
+/* Function for building the exact cover structure shared by the uniqueness checks */
+struct CoverMatrix *initCoverMatrix(int size)
+{
+	int n_columns = 4 * size * size;
+	int n_rows = size * size * size;
+	int box_size = (int)sqrt(size);
+	struct CoverMatrix *matrix = malloc(sizeof(struct CoverMatrix));
+
+	if (matrix == NULL)
+		return NULL;
+
+	matrix->size = size;
+	matrix->nodes = malloc((1 + n_columns + 4 * n_rows) *
+			       sizeof(struct node));
+	matrix->rows = malloc(n_rows * sizeof(struct node *));
+	matrix->selected = malloc(size * size * sizeof(struct node *));
+	matrix->covered = calloc(n_columns, sizeof(char));
+	if (matrix->nodes == NULL || matrix->rows == NULL ||
+	    matrix->selected == NULL || matrix->covered == NULL) {
+		destroyCoverMatrix(matrix);
+		return NULL;
+	}
+
+	// The head, then the column headers in a ring
+	struct node *head = matrix->nodes;
+
+	head->left = head->right = head->up = head->down = head;
+	head->colHead = head;
+	head->size = -1;
+	for (int c = 0; c < n_columns; c++) {
+		struct node *column = &matrix->nodes[1 + c];
+
+		column->up = column->down = column->colHead = column;
+		column->size = 0;
+		column->right = head;
+		column->left = head->left;
+		head->left->right = column;
+		head->left = column;
+	}
+	matrix->head = head;
+
+	// Each candidate fills a cell and places its value in a row, a column and a box
+	for (int i = 0; i < size; i++) {
+		for (int j = 0; j < size; j++) {
+			int box = (i / box_size) * box_size + j / box_size;
+
+			for (int v = 0; v < size; v++) {
+				int r = (i * size + j) * size + v;
+				int columns[4] = {
+					i * size + j,
+					size * size + i * size + v,
+					2 * size * size + j * size + v,
+					3 * size * size + box * size + v
+				};
+				struct node *row = &matrix->nodes[1 + n_columns +
+								  4 * r];
+
+				for (int k = 0; k < 4; k++) {
+					struct node *node = &row[k];
+					struct node *column =
+						&matrix->nodes[1 + columns[k]];
+
+					node->id[0] = v + 1;
+					node->id[1] = i + 1;
+					node->id[2] = j + 1;
+					node->left = &row[(k + 3) % 4];
+					node->right = &row[(k + 1) % 4];
+					node->colHead = column;
+					node->down = column;
+					node->up = column->up;
+					column->up->down = node;
+					column->up = node;
+					column->size++;
+				}
+				matrix->rows[r] = row;
+			}
+		}
+	}
+
+	return matrix;
+}
+
+/* Function to destroy the CoverMatrix struct */
+void destroyCoverMatrix(struct CoverMatrix *matrix)
+{
+	if (matrix == NULL)
+		return;
+
+	free(matrix->covered);
+	free(matrix->selected);
+	free(matrix->rows);
+	free(matrix->nodes);
+	free(matrix);
+}
+
+/* Algorithm X counting solutions, up to a limit */
+static int searchSolutions(struct node *head, int limit)
+{
+	if (head->right == head)
+		return 1;
+
+	struct node *col = chooseColumn(head);
+
+	// A constraint nothing can satisfy anymore
+	if (col->size == 0)
+		return 0;
+
+	int count = 0;
+
+	cover(col);
+	for (struct node *i = col->down; i != col && count < limit;
+	     i = i->down) {
+		for (struct node *j = i->right; j != i; j = j->right)
+			cover(j->colHead);
+		count += searchSolutions(head, limit - count);
+		for (struct node *j = i->left; j != i; j = j->left)
+			uncover(j->colHead);
+	}
+	uncover(col);
+
+	return count;
+}
+
+/* Function for counting the solutions of a puzzle with the shared structure */
+int countSolutions(struct CoverMatrix *matrix, struct Sudoku *sudoku,
+		   int limit)
+{
+	int size = matrix->size;
+	int n_selected = 0;
+	int count = 0;
+	int conflict = 0;
+
+	// Select the row of every given, unless it clashes with an earlier one
+	for (int i = 0; i < size && !conflict; i++) {
+		for (int j = 0; j < size && !conflict; j++) {
+			int value = sudoku->grid[i][j];
+
+			if (value == 0)
+				continue;
+
+			struct node *row =
+				matrix->rows[(i * size + j) * size + value - 1];
+			struct node *node = row;
+
+			do {
+				if (matrix->covered[node->colHead -
+						    matrix->nodes - 1])
+					conflict = 1;
+				node = node->right;
+			} while (node != row);
+			if (conflict)
+				break;
+
+			node = row;
+			do {
+				matrix->covered[node->colHead -
+						matrix->nodes - 1] = 1;
+				cover(node->colHead);
+				node = node->right;
+			} while (node != row);
+			matrix->selected[n_selected++] = row;
+		}
+	}
+
+	if (!conflict)
+		count = searchSolutions(matrix->head, limit);
+
+	// Take the givens back in reverse, leaving the structure as it was
+	while (n_selected > 0) {
+		struct node *row = matrix->selected[--n_selected];
+		struct node *node = row->left;
+
+		do {
+			uncover(node->colHead);
+			matrix->covered[node->colHead - matrix->nodes - 1] = 0;
+			node = node->left;
+		} while (node != row->left);
+	}
+
+	return count;
+}
+
+/* Function for searching a solution with another value in an empty cell */
+int hasOtherSolution(struct CoverMatrix *matrix, struct Sudoku *sudoku,
+		     int row, int col, int value)
+{
+	int size = matrix->size;
+	struct node *excluded = matrix->rows[(row * size + col) * size +
+					     value - 1];
+	struct node *node = excluded;
+
+	// Unlink the row from its columns, no search can select it then
+	do {
+		node->up->down = node->down;
+		node->down->up = node->up;
+		node->colHead->size--;
+		node = node->right;
+	} while (node != excluded);
+
+	int found = countSolutions(matrix, sudoku, 1);
+
+	// Link it back in reverse order
+	node = excluded->left;
+	do {
+		node->colHead->size++;
+		node->up->down = node;
+		node->down->up = node;
+		node = node->left;
+	} while (node != excluded->left);
+
+	return found;
+}
+
 /* Function for initializing the Exact Cover Problem */
 struct ExactCover *initExactCover(struct Sudoku *sudoku)
 {
@@ -1,7 +1,10 @@
 // SPDX-License-Identifier: GPL-3.0
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +13,15 @@
 #include "../include/solver.h"
 #include "../include/sudoku.h"
 
+/* Function for reading the wall clock, the threads share the work */
+double wallTime(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
 /* Function for initializing the Sudoku struct */
 struct Sudoku *initSudoku(int size)
 {
@@ -75,7 +87,6 @@ void insertFirstLine(struct Sudoku *sudoku)
 		firstRow[i] = i + 1;
 
 	// Shuffle the array using Fisher-Yates algorithm
-	srand(time(NULL)); // Initialize random seed
 	for (int i = sudoku->size - 1; i > 0; i--) {
 		int j = rand() % (i + 1);
 		// Swap firstRow[i] and firstRow[j]
@@ -93,51 +104,142 @@ void insertFirstLine(struct Sudoku *sudoku)
 	free(firstRow);
 }
 
-/* Function to check if a Sudoku puzzle has a unique solution */
-int hasUniqueSolution(struct Sudoku *sudoku, struct Sudoku *solution)
+/* Function for shuffling an array with the Fisher-Yates algorithm */
+static void shuffleArray(int *array, int count)
 {
-	// Create a copy of the current puzzle state
-	struct Sudoku *copy = initSudoku(sudoku->size);
+	for (int i = count - 1; i > 0; i--) {
+		int j = rand() % (i + 1);
+		int temp = array[i];
 
-	for (int i = 0; i < sudoku->size; i++)
-		for (int j = 0; j < sudoku->size; j++)
-			copy->grid[i][j] = sudoku->grid[i][j];
+		array[i] = array[j];
+		array[j] = temp;
+	}
+}
+
+/* Function for shuffling the lines of a grid, within and between groups */
+static void shuffleLines(int *order, int box_size)
+{
+	int *groups = malloc(box_size * sizeof(int));
 
-	// Try to solve the copy
-	int solved = SudokuSolver(copy);
+	for (int g = 0; g < box_size; g++)
+		groups[g] = g;
+	shuffleArray(groups, box_size);
 
-	if (!solved) {
-		destroySudoku(copy);
-		return 0; // No solution found
+	// Line i of group g is a line of another group, in any order
+	for (int g = 0; g < box_size; g++) {
+		for (int i = 0; i < box_size; i++)
+			order[g * box_size + i] = groups[g] * box_size + i;
+		shuffleArray(&order[g * box_size], box_size);
 	}
 
-	// Check if the solution is different from our original solution
-	for (int i = 0; i < sudoku->size; i++) {
-		for (int j = 0; j < sudoku->size; j++) {
-			if (copy->grid[i][j] != solution->grid[i][j]) {
-				destroySudoku(copy);
-				return 0; // Different solution found, not unique
-			}
+	free(groups);
+}
+
+/* Function for applying a random symmetry of Sudoku to a complete grid */
+void transformSudoku(struct Sudoku *sudoku)
+{
+	int size = sudoku->size;
+	int box_size = sudoku->squareRootOfSize;
+	int *digits = malloc(size * sizeof(int));
+	int *rows = malloc(size * sizeof(int));
+	int *cols = malloc(size * sizeof(int));
+	struct Sudoku *copy = initSudoku(size);
+
+	for (int v = 0; v < size; v++)
+		digits[v] = v + 1;
+	shuffleArray(digits, size);
+	shuffleLines(rows, box_size);
+	shuffleLines(cols, box_size);
+
+	int transpose = rand() % 2;
+
+	for (int i = 0; i < size; i++)
+		memcpy(copy->grid[i], sudoku->grid[i], size * sizeof(int));
+
+	for (int i = 0; i < size; i++) {
+		for (int j = 0; j < size; j++) {
+			int value = digits[copy->grid[rows[i]][cols[j]] - 1];
+
+			if (transpose)
+				sudoku->grid[j][i] = value;
+			else
+				sudoku->grid[i][j] = value;
 		}
 	}
 
 	destroySudoku(copy);
-	return 1; // Solution is unique
+	free(digits);
+	free(rows);
+	free(cols);
+}
+
+/* Function for filling the grid from a shuffled pattern */
+void fillFromPattern(struct Sudoku *sudoku)
+{
+	int size = sudoku->size;
+	int box_size = sudoku->squareRootOfSize;
+
+	// Each band shifts the row above by a box, each new band by one more
+	for (int i = 0; i < size; i++)
+		for (int j = 0; j < size; j++)
+			sudoku->grid[i][j] = (box_size * (i % box_size) +
+					      i / box_size + j) % size + 1;
+
+	transformSudoku(sudoku);
+}
+
+/* One speculative removal, tested on a private copy of the puzzle */
+struct RemovalTest {
+	struct CoverMatrix *matrix;	/* Exact cover structure of the thread */
+	struct Sudoku *puzzle;	/* The puzzle with the cell emptied */
+	int row;		/* Row of the cell */
+	int col;		/* Column of the cell */
+	int value;		/* Value the cell held */
+	int rejected;		/* Set when another solution exists */
+	pthread_t thread;
+	int started;		/* Whether the test runs on its own thread */
+};
+
+/* Function for running one removal test */
+static void *runRemovalTest(void *arg)
+{
+	struct RemovalTest *test = arg;
+
+	test->rejected = hasOtherSolution(test->matrix, test->puzzle,
+					  test->row, test->col, test->value);
+	return NULL;
 }
 
 /* Function to remove numbers from the board while ensuring a unique solution */
-void removeNumbers(struct Sudoku *sudoku)
+void removeNumbers(struct Sudoku *sudoku, int n_threads)
 {
 	int size = sudoku->size;
 	time_t rawtime;
 	struct tm *timeinfo;
 
-	// Create a copy of the complete solution
-	struct Sudoku *solution = initSudoku(size);
+	if (n_threads < 1)
+		n_threads = 1;
 
-	for (int i = 0; i < size; i++)
-		for (int j = 0; j < size; j++)
-			solution->grid[i][j] = sudoku->grid[i][j];
+	// Every thread gets its own exact cover structure and puzzle copy
+	struct RemovalTest *tests = calloc(n_threads, sizeof(*tests));
+
+	if (tests == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory for solver\n");
+		return;
+	}
+	for (int t = 0; t < n_threads; t++) {
+		tests[t].matrix = initCoverMatrix(size);
+		tests[t].puzzle = initSudoku(size);
+		if (tests[t].matrix == NULL) {
+			fprintf(stderr, "Error: Failed to allocate memory for solver\n");
+			for (int u = 0; u <= t; u++) {
+				destroyCoverMatrix(tests[u].matrix);
+				destroySudoku(tests[u].puzzle);
+			}
+			free(tests);
+			return;
+		}
+	}
 
 	// Create an array to track essential cells (cells that must keep their values)
 	int total_cells = size * size;
@@ -162,7 +264,6 @@ void removeNumbers(struct Sudoku *sudoku)
 	}
 
 	// Shuffle the array using Fisher-Yates algorithm
-	srand(time(NULL));
 	for (int i = total_cells - 1; i > 0; i--) {
 		int j = rand() % (i + 1);
 		// Swap cells[i] and cells[j]
@@ -178,47 +279,95 @@ void removeNumbers(struct Sudoku *sudoku)
 	// Try to remove numbers while maintaining a unique solution
 	int removed = 0;
 	int attempted = 0;
+	int first = 0;
+	int done = 0;
+
+	// Each round tests the next n_threads undecided cells in shuffle order
+	// against the same puzzle. A rejection stays valid once other cells are
+	// emptied, since that only adds solutions, but a success only holds for
+	// the puzzle it was tested on: the first one is applied and the later
+	// ones are tested again in the next round. The puzzle is the one the
+	// cells tested one by one would give, whatever the number of threads.
+	while (!done) {
+		int count = 0;
+
+		// Skip the cells decided in earlier rounds
+		while (first < total_cells &&
+		       (essential[cells[first].row * size + cells[first].col] ||
+			sudoku->grid[cells[first].row][cells[first].col] == 0))
+			first++;
+
+		for (int k = first; k < total_cells && count < n_threads; k++) {
+			int row = cells[k].row;
+			int col = cells[k].col;
+
+			if (essential[row * size + col] || sudoku->grid[row][col] == 0)
+				continue;
+
+			struct RemovalTest *test = &tests[count++];
+
+			for (int i = 0; i < size; i++)
+				memcpy(test->puzzle->grid[i], sudoku->grid[i],
+				       size * sizeof(int));
+			test->row = row;
+			test->col = col;
+			test->value = sudoku->grid[row][col];
+			test->puzzle->grid[row][col] = 0;
+		}
+		if (count == 0)
+			break;
 
-	for (int i = 0; i < total_cells; i++) {
-		int row = cells[i].row;
-		int col = cells[i].col;
-
-		// Skip if this cell has already been determined to be essential
-		if (essential[row * size + col])
-			continue;
-
-		int temp = sudoku->grid[row][col];
-
-		attempted++;
-
-		// Try removing this number
-		sudoku->grid[row][col] = 0;
-
-		// Check if the puzzle still has a unique solution
-		if (!hasUniqueSolution(sudoku, solution)) {
-			// If not, put the number back and mark as essential
-			sudoku->grid[row][col] = temp;
-			essential[row * size + col] = 1;
-		} else {
-			removed++;
+		// The calling thread takes the first test, a failed thread start
+		// leaves the test to it as well
+		for (int t = 1; t < count; t++)
+			tests[t].started = pthread_create(&tests[t].thread, NULL,
+							  runRemovalTest,
+							  &tests[t]) == 0;
+		runRemovalTest(&tests[0]);
+		for (int t = 1; t < count; t++) {
+			if (tests[t].started)
+				pthread_join(tests[t].thread, NULL);
+			else
+				runRemovalTest(&tests[t]);
 		}
 
-		// Optional: Add a limit to the number of cells to remove for time efficiency
-		if (size >= 25 && removed >=
-		    total_cells * 0.52) // Remove only about 52% of cells for 25x25 and bigger
-			break;
+		int applied = 0;
+
+		for (int t = 0; t < count; t++) {
+			struct RemovalTest *test = &tests[t];
+
+			if (test->rejected) {
+				// Keep the number and mark the cell as essential
+				essential[test->row * size + test->col] = 1;
+			} else if (!applied) {
+				sudoku->grid[test->row][test->col] = 0;
+				removed++;
+				applied = 1;
+			} else {
+				// Tested against a puzzle that has changed since
+				continue;
+			}
+			attempted++;
 
-		// // Another optimization: if we've tried a lot without success, quit early
-		// if (attempted - removed > total_cells * 0.2)
-		//	break;
+			// Optional: Add a limit to the number of cells to remove for time efficiency
+			if (size >= 25 && removed >=
+			    total_cells * 0.52) { // Remove only about 52% of cells for 25x25 and bigger
+				done = 1;
+				break;
+			}
 
-		// Optional: Print progress
-		time(&rawtime);
-		timeinfo = localtime(&rawtime);
-		printf("Attempt %d - Removed %d - %s", attempted, removed, asctime(timeinfo));
+			// Optional: Print progress
+			time(&rawtime);
+			timeinfo = localtime(&rawtime);
+			printf("Attempt %d - Removed %d - %s", attempted, removed, asctime(timeinfo));
+		}
 	}
 
-	destroySudoku(solution);
+	for (int t = 0; t < n_threads; t++) {
+		destroyCoverMatrix(tests[t].matrix);
+		destroySudoku(tests[t].puzzle);
+	}
+	free(tests);
 	free(cells);
 	free(essential);
 
@@ -1,38 +1,168 @@
 /* SPDX-License-Identifier: GPL-3.0 */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+/* Biggest puzzle side, one bit per value in an unsigned long */
+#define MAX_SIZE ((int)(8 * sizeof(unsigned long)))
+
+/* Default number of guesses the tasks of the parallel search start with */
+#define DEFAULT_DEPTH 3
+
+/* Tasks queued for the workers at most */
+#define QUEUE_SIZE 256
+
+/* Biggest transposition table, in bits of the index */
+#define MAX_TABLE_BITS 28
+
+/*
+ * The puzzle being solved, with the values already placed in each row,
+ * column and box as bitmasks: bit v - 1 is set once value v is there.
+ * It holds its own compact copy of the grid, so a task of the parallel
+ * search is just a copy of the board.
+ */
+struct board {
+	int n;
+	int subrow, subcol; /* Sub-grid dimensions */
+	unsigned long all; /* Every value */
+	unsigned long rows[MAX_SIZE];
+	unsigned long cols[MAX_SIZE];
+	unsigned long boxes[MAX_SIZE];
+	unsigned char cells[MAX_SIZE * MAX_SIZE]; /* Row by row, 0 if empty */
+	const int *stop; /* Give up once set, or NULL */
+	const unsigned long *keys; /* Zobrist keys to hash with, or NULL */
+	unsigned long hash;
+};
+
+/*
+ * Transposition table of solution counts. Branching on one cell at a time
+ * never reaches the same partial grid twice, but grids whose values are
+ * swapped around a rectangle leave the same empty cells and the same row,
+ * column and box masks, so the same completions. The Zobrist key of value
+ * v in a cell mixes one random key for the cell with one for v in each of
+ * its row, column and box, so that the hash of a board, updated with a
+ * single XOR as values come and go, only depends on those. The table is
+ * indexed by the low bits of the hash and a new entry simply replaces the
+ * one in its slot.
+ */
+struct table_entry {
+	unsigned long hash;
+	unsigned long count; /* Solutions below, plus one; 0 if free */
+};
+
+struct transposition_table {
+	unsigned long *keys; /* Of value v in cell c at [c * n + v - 1] */
+	struct table_entry *entries;
+	unsigned long mask; /* Index bits */
+	unsigned long hits;
+	unsigned long stores;
+};
+
+/*
+ * Work queue of the parallel search. The main thread explores the first
+ * guesses and queues a copy of every board it reaches at the cutoff depth,
+ * the workers solve them. The first worker to find a solution sets the
+ * stop flag, which every search checks at each step.
+ */
+struct task_queue {
+	struct board *tasks; /* Ring of QUEUE_SIZE boards */
+	int head;
+	int count;
+	int done; /* No more tasks to come */
+	int stop; /* A solution was found */
+	struct board solution;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
 int read_size_from_file(const char *filename);
 int **create_grid(int n);
 void free_grid(int **grid, int n);
 int read_grid_from_file(int **grid, const char *filename);
 void display_sudoku(int **grid, int n);
-int is_safe(int **grid, int row, int col, int num, int n, int subrow,
-	int subcol);
-int solve_sudoku(int **grid, int n, int subrow, int subcol);
+int init_board(struct board *board, int **grid, int n);
+void store_board(const struct board *board, int **grid);
+int solve_sudoku(struct board *board);
+int solve_parallel(struct board *board, int n_threads, int depth);
+struct transposition_table *create_table(int n, int bits);
+void free_table(struct transposition_table *table);
+void hash_board(struct board *board, const struct transposition_table *table);
+unsigned long count_solutions(struct board *board,
+			      struct transposition_table *table,
+			      unsigned long limit, struct board *first);
 
 int main(int argc, char **argv)
 {
 	char *filename;
-	int i, j; /* Loop variables */
+	int i; /* Loop variable */
+	int arg;
 	int n;
-	int subrow, subcol; /* Sub-grid dimensions */
+	int n_threads;
+	int depth;
+	int table_bits;
+	int solved;
+	unsigned long limit;
+	unsigned long solutions;
 	int **grid;
-	clock_t start_time;
-	clock_t end_time;
+	struct board board;
+	struct board first;
+	struct transposition_table *table;
+	struct timespec start_time;
+	struct timespec end_time;
 	double computation_time;
 
+	/* Parse the options */
+	n_threads = 0;
+	depth = DEFAULT_DEPTH;
+	limit = 0;
+	table_bits = 0;
+	for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-j") == 0)
+			n_threads = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-d") == 0)
+			depth = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-c") == 0)
+			limit = strtoul(argv[arg + 1], NULL, 10);
+		else if (strcmp(argv[arg], "-t") == 0)
+			table_bits = atoi(argv[arg + 1]);
+		else
+			break;
+	}
+
 	/* Check if the correct number of arguments is passed */
-	if (argc != 2) {
-		fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
+	if (argc - arg != 1) {
+		fprintf(stderr,
+			"Usage: %s [-j threads] [-d depth] [-c limit] [-t table_bits] <filename>\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (table_bits < 0 || table_bits > MAX_TABLE_BITS) {
+		fprintf(stderr, "Error: The table takes 0 to %d bits\n",
+			MAX_TABLE_BITS);
+		return 1;
+	}
+
+	/* Counting and the table belong to the serial search */
+	if (n_threads > 0 && (limit > 0 || table_bits > 0)) {
+		fprintf(stderr, "Error: -c and -t don't apply with -j\n");
+		return 1;
+	}
+
+	if (n_threads < 0 || depth < 0) {
+		fprintf(stderr, "Error: Threads and depth can't be negative\n");
 		return 1;
 	}
 
 	/* Parse the filename from command line */
-	filename = argv[1];
+	filename = argv[arg];
 
 	/* Read the size of the Sudoku grid from the file */
 	n = read_size_from_file(filename);
@@ -41,6 +171,12 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	if (n > MAX_SIZE) {
+		fprintf(stderr, "Error: Size %d is bigger than %d\n", n,
+			MAX_SIZE);
+		return 1;
+	}
+
 	/* Allocate memory for the Sudoku grid */
 	grid = create_grid(n);
 	if (grid == NULL) {
@@ -63,24 +199,69 @@ int main(int argc, char **argv)
 	display_sudoku(grid, n);
 	printf("\n\n\n");
 
-	/* Start timing the computation */
-	start_time = clock();
-
-	/* Generate a complete Sudoku grid */
-	subrow = (int)sqrt(n);
-	subcol = (int)sqrt(n);
+	/* Start timing the computation, wall clock for the parallel search */
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
 
 	printf("Solving the sudoku...\n\n");
-	solve_sudoku(grid, n, subrow, subcol);
+	solved = 0;
+	table = NULL;
+	solutions = 0;
+	if (init_board(&board, grid, n) != 0) {
+		/* Givens in conflict */
+	} else if (n_threads > 0) {
+		solved = solve_parallel(&board, n_threads, depth);
+	} else if (limit > 0 || table_bits > 0) {
+		/* Without -c, look for one solution through the table */
+		if (table_bits > 0) {
+			table = create_table(n, table_bits);
+			if (table == NULL) {
+				fprintf(stderr, "Error: Failed to allocate memory for table\n");
+				free_grid(grid, n);
+				return 1;
+			}
+			hash_board(&board, table);
+		}
+
+		first.n = 0;
+		solutions = count_solutions(&board, table,
+					    limit > 0 ? limit : 1, &first);
+		if (solutions > 0) {
+			board = first;
+			solved = 1;
+		}
+	} else {
+		solved = solve_sudoku(&board);
+	}
+
+	if (solved < 0) {
+		fprintf(stderr, "Error: Failed to start the workers\n");
+		free_grid(grid, n);
+		return 1;
+	}
+
+	if (solved)
+		store_board(&board, grid);
+	else
+		printf("The sudoku has no solution.\n\n");
 	printf("The proposed grid:\n");
 	display_sudoku(grid, n);
 
 	/* End timing */
-	end_time = clock();
-	computation_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	computation_time = (double)(end_time.tv_sec - start_time.tv_sec) +
+			   (double)(end_time.tv_nsec - start_time.tv_nsec) / 1e9;
 	printf("\nTotal computation completed in %.6f seconds.\n",
 	       computation_time);
 
+	if (limit > 0)
+		printf("Solutions found: %lu%s\n", solutions,
+		       solutions == limit ? " (limit reached)" : "");
+	if (table != NULL) {
+		printf("Transposition table: %lu hits, %lu stores\n",
+		       table->hits, table->stores);
+		free_table(table);
+	}
+
 	/* Free allocated memory */
 	free_grid(grid, n);
 
@@ -255,105 +436,489 @@ void display_sudoku(int **grid, int n)
 	}
 }
 
-/* Check if it's safe to place a number at a specific position */
-int is_safe(int **grid, int row, int col, int num, int n, int subrow,
-	    int subcol)
+/*
+ * Fills the board from the givens.
+ *
+ * @return 0, or -1 if a given is out of range or repeats a value of its
+ * row, column or box
+ */
+int init_board(struct board *board, int **grid, int n)
 {
-	int x;
-	int i, j;
-	int startRow;
-	int startCol;
+	int i, j; /* Loop variables */
+	int box;
+	unsigned long bit;
 
-	/* Check if 'num' is not already placed in current row */
-	for (x = 0; x < n; x++) {
-		if (grid[row][x] == num) {
-			return 0;
-		}
-	}
+	board->n = n;
+	board->subrow = (int)sqrt(n);
+	board->subcol = (int)sqrt(n);
+	board->all = n == MAX_SIZE ? ~0UL : (1UL << n) - 1;
+	board->stop = NULL;
+	board->keys = NULL;
+	board->hash = 0;
 
-	/* Check if 'num' is not already placed in current column */
-	for (x = 0; x < n; x++) {
-		if (grid[x][col] == num) {
-			return 0;
-		}
+	for (i = 0; i < n; i++) {
+		board->rows[i] = 0;
+		board->cols[i] = 0;
+		board->boxes[i] = 0;
 	}
 
-	/* Check if 'num' is not already placed in current sub-grid */
-	startRow = row - row % subrow;
-	startCol = col - col % subcol;
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			board->cells[i * n + j] = 0;
+			if (grid[i][j] == 0)
+				continue;
+			if (grid[i][j] < 0 || grid[i][j] > n)
+				return -1;
 
-	for (i = 0; i < subrow; i++) {
-		for (j = 0; j < subcol; j++) {
-			if (grid[i + startRow][j + startCol] == num) {
-				return 0;
-			}
+			bit = 1UL << (grid[i][j] - 1);
+			box = (i / board->subrow) * board->subrow +
+			      j / board->subcol;
+			if ((board->rows[i] | board->cols[j] |
+			     board->boxes[box]) & bit)
+				return -1;
+
+			board->cells[i * n + j] = grid[i][j];
+			board->rows[i] |= bit;
+			board->cols[j] |= bit;
+			board->boxes[box] |= bit;
 		}
 	}
 
-	return 1;
+	return 0;
 }
 
-/* Solve the Sudoku grid using backtracking */
-int solve_sudoku(int **grid, int n, int subrow, int subcol)
+/* Copy the values of the board back to the grid */
+void store_board(const struct board *board, int **grid)
 {
-	int row = 0, col = 0;
-	int isEmpty = 0;
-	int *numbers;
-	int i, j, temp, num_idx, num;
+	int i, j; /* Loop variables */
+
+	for (i = 0; i < board->n; i++)
+		for (j = 0; j < board->n; j++)
+			grid[i][j] = board->cells[i * board->n + j];
+}
+
+/*
+ * Find the empty cell with the fewest legal values.
+ *
+ * @return The number of its legal values, 0 if some cell has none, -1 if
+ * the board is full
+ */
+static int pick_cell(const struct board *board, int *best_cell,
+		     int *best_box, unsigned long *best_legal)
+{
+	int row, col;
+	int box;
+	int count, best_count;
+	int n;
+	unsigned long legal;
+
+	n = board->n;
+	best_count = n + 1;
 
-	/* Find an empty position */
 	for (row = 0; row < n; row++) {
 		for (col = 0; col < n; col++) {
-			if (grid[row][col] == 0) {
-				isEmpty = 1;
-				break;
+			if (board->cells[row * n + col] != 0)
+				continue;
+
+			box = (row / board->subrow) * board->subrow +
+			      col / board->subcol;
+			legal = board->all & ~(board->rows[row] |
+					       board->cols[col] |
+					       board->boxes[box]);
+
+			/* A dead end, no need to look further */
+			if (legal == 0)
+				return 0;
+
+			count = __builtin_popcountl(legal);
+			if (count < best_count) {
+				*best_cell = row * n + col;
+				*best_box = box;
+				*best_legal = legal;
+				best_count = count;
+				if (count == 1)
+					return 1;
 			}
 		}
-		if (isEmpty) {
+	}
+
+	return best_count <= n ? best_count : -1;
+}
+
+/* Place the value of a single bit, or take it back */
+static void set_value(struct board *board, int cell, int box,
+		      unsigned long bit)
+{
+	board->cells[cell] = __builtin_ctzl(bit) + 1;
+	if (board->keys != NULL)
+		board->hash ^= board->keys[cell * board->n +
+					   board->cells[cell] - 1];
+	board->rows[cell / board->n] |= bit;
+	board->cols[cell % board->n] |= bit;
+	board->boxes[box] |= bit;
+}
+
+static void clear_value(struct board *board, int cell, int box,
+			unsigned long bit)
+{
+	if (board->keys != NULL)
+		board->hash ^= board->keys[cell * board->n +
+					   board->cells[cell] - 1];
+	board->cells[cell] = 0;
+	board->rows[cell / board->n] &= ~bit;
+	board->cols[cell % board->n] &= ~bit;
+	board->boxes[box] &= ~bit;
+}
+
+/*
+ * Solve the Sudoku grid using backtracking, always on the empty cell with
+ * the fewest legal values
+ */
+int solve_sudoku(struct board *board)
+{
+	int cell, box;
+	int count;
+	unsigned long legal;
+	unsigned long bit;
+
+	/* Another worker found a solution */
+	if (board->stop != NULL &&
+	    __atomic_load_n(board->stop, __ATOMIC_RELAXED))
+		return 0;
+
+	/* If no empty position is found, we've solved the puzzle */
+	count = pick_cell(board, &cell, &box, &legal);
+	if (count <= 0)
+		return count < 0;
+
+	/* Try every legal value, lowest bit first */
+	for (; legal != 0; legal &= legal - 1) {
+		bit = legal & (~legal + 1);
+		set_value(board, cell, box, bit);
+
+		/* Recur to fill the rest of the grid */
+		if (solve_sudoku(board))
+			return 1;
+
+		/* If it doesn't lead to a solution, try another value */
+		clear_value(board, cell, box, bit);
+	}
+
+	/* If no value can be placed, backtrack */
+	return 0;
+}
+
+/*
+ * Queue a copy of the board, waiting for room unless the search is over.
+ */
+static void push_task(struct task_queue *queue, const struct board *board)
+{
+	pthread_mutex_lock(&queue->lock);
+	while (queue->count == QUEUE_SIZE &&
+	       !__atomic_load_n(&queue->stop, __ATOMIC_RELAXED))
+		pthread_cond_wait(&queue->not_full, &queue->lock);
+
+	if (!__atomic_load_n(&queue->stop, __ATOMIC_RELAXED)) {
+		queue->tasks[(queue->head + queue->count) % QUEUE_SIZE] = *board;
+		++queue->count;
+		pthread_cond_signal(&queue->not_empty);
+	}
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * Explore the first depth guesses like solve_sudoku() does, queueing a
+ * task for every board reached instead of going deeper. Dead ends are
+ * dropped on the way, and a board solved early is queued as it is.
+ */
+static void spawn_tasks(struct task_queue *queue, struct board *board,
+			int depth)
+{
+	int cell, box;
+	int count;
+	unsigned long legal;
+	unsigned long bit;
+
+	if (__atomic_load_n(&queue->stop, __ATOMIC_RELAXED))
+		return;
+
+	count = pick_cell(board, &cell, &box, &legal);
+	if (count == 0)
+		return;
+
+	if (count < 0 || depth == 0) {
+		push_task(queue, board);
+		return;
+	}
+
+	for (; legal != 0; legal &= legal - 1) {
+		bit = legal & (~legal + 1);
+		set_value(board, cell, box, bit);
+		spawn_tasks(queue, board, depth - 1);
+		clear_value(board, cell, box, bit);
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	struct task_queue *queue;
+	struct board board;
+
+	queue = (struct task_queue *)arg;
+	for (;;) {
+		pthread_mutex_lock(&queue->lock);
+		while (queue->count == 0 && !queue->done &&
+		       !__atomic_load_n(&queue->stop, __ATOMIC_RELAXED))
+			pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+		/* Out of tasks, or the search is over */
+		if (queue->count == 0 ||
+		    __atomic_load_n(&queue->stop, __ATOMIC_RELAXED)) {
+			pthread_mutex_unlock(&queue->lock);
 			break;
 		}
+
+		board = queue->tasks[queue->head];
+		queue->head = (queue->head + 1) % QUEUE_SIZE;
+		--queue->count;
+		pthread_cond_signal(&queue->not_full);
+		pthread_mutex_unlock(&queue->lock);
+
+		board.stop = &queue->stop;
+		if (!solve_sudoku(&board))
+			continue;
+
+		/* Keep the first solution and stop everyone */
+		pthread_mutex_lock(&queue->lock);
+		if (!__atomic_load_n(&queue->stop, __ATOMIC_RELAXED)) {
+			queue->solution = board;
+			__atomic_store_n(&queue->stop, 1, __ATOMIC_RELAXED);
+		}
+		pthread_cond_broadcast(&queue->not_empty);
+		pthread_cond_broadcast(&queue->not_full);
+		pthread_mutex_unlock(&queue->lock);
 	}
 
-	/* If no empty position is found, we've solved the puzzle */
-	if (!isEmpty) {
-		return 1;
+	return NULL;
+}
+
+/*
+ * Solve the Sudoku grid with n_threads workers sharing the subtrees below
+ * the first depth guesses.
+ *
+ * @return 1 if solved, with the solution in the board, 0 if there is
+ * none, -1 on error
+ */
+int solve_parallel(struct board *board, int n_threads, int depth)
+{
+	struct task_queue *queue;
+	pthread_t *workers;
+	int n_started;
+	int solved;
+	int i; /* Loop variable */
+
+	queue = (struct task_queue *)malloc(sizeof(struct task_queue));
+	workers = (pthread_t *)malloc(n_threads * sizeof(pthread_t));
+	if (queue == NULL || workers == NULL) {
+		free(workers);
+		free(queue);
+		return -1;
 	}
 
-	/* Create an array with numbers 1 to n and shuffle it for random generation */
-	numbers = (int *)malloc(n * sizeof(int));
-	for (i = 0; i < n; i++) {
-		numbers[i] = i + 1;
+	queue->tasks = (struct board *)malloc(QUEUE_SIZE *
+					      sizeof(struct board));
+	if (queue->tasks == NULL) {
+		free(workers);
+		free(queue);
+		return -1;
 	}
+	queue->head = 0;
+	queue->count = 0;
+	queue->done = 0;
+	queue->stop = 0;
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->not_empty, NULL);
+	pthread_cond_init(&queue->not_full, NULL);
+
+	for (n_started = 0; n_started < n_threads; n_started++)
+		if (pthread_create(&workers[n_started], NULL, worker_main,
+				   queue) != 0)
+			break;
+
+	/* The main thread hands out the tasks while the workers solve them */
+	if (n_started == n_threads)
+		spawn_tasks(queue, board, depth);
+
+	pthread_mutex_lock(&queue->lock);
+	queue->done = 1;
+	if (n_started < n_threads)
+		__atomic_store_n(&queue->stop, 1, __ATOMIC_RELAXED);
+	pthread_cond_broadcast(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+
+	for (i = 0; i < n_started; i++)
+		pthread_join(workers[i], NULL);
+
+	if (n_started < n_threads)
+		solved = -1;
+	else if (queue->stop) {
+		*board = queue->solution;
+		board->stop = NULL;
+		solved = 1;
+	} else
+		solved = 0;
+
+	pthread_cond_destroy(&queue->not_full);
+	pthread_cond_destroy(&queue->not_empty);
+	pthread_mutex_destroy(&queue->lock);
+	free(queue->tasks);
+	free(workers);
+	free(queue);
+
+	return solved;
+}
 
-	/* Simple Fisher-Yates shuffle */
-	for (i = n - 1; i > 0; i--) {
-		j = rand() % (i + 1);
-		temp = numbers[i];
-		numbers[i] = numbers[j];
-		numbers[j] = temp;
+/* Next random number of a xorshift generator */
+static unsigned long next_random(unsigned long *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/*
+ * Allocate a table of 2^bits entries, with the Zobrist keys of size n
+ * puzzles. The keys come from a fixed seed, so runs are repeatable.
+ */
+struct transposition_table *create_table(int n, int bits)
+{
+	struct transposition_table *table;
+	unsigned long *parts;
+	unsigned long state;
+	int row, col, box, value;
+	int i; /* Loop variable */
+
+	table = (struct transposition_table *)
+		malloc(sizeof(struct transposition_table));
+	if (table == NULL)
+		return NULL;
+
+	table->mask = (1UL << bits) - 1;
+	table->hits = 0;
+	table->stores = 0;
+	table->keys = (unsigned long *)malloc((size_t)n * n * n *
+					      sizeof(unsigned long));
+	table->entries = (struct table_entry *)
+		calloc(table->mask + 1, sizeof(struct table_entry));
+
+	/* A key per cell, then per value of each row, column and box */
+	parts = (unsigned long *)malloc(4 * n * n * sizeof(unsigned long));
+	if (table->keys == NULL || table->entries == NULL || parts == NULL) {
+		free(parts);
+		free_table(table);
+		return NULL;
 	}
 
-	/* Try different numbers at the current empty position */
-	for (num_idx = 0; num_idx < n; num_idx++) {
-		num = numbers[num_idx];
+	state = 88172645463325252UL;
+	for (i = 0; i < 4 * n * n; i++)
+		parts[i] = next_random(&state);
 
-		/* Check if 'num' can be placed at (row, col) */
-		if (is_safe(grid, row, col, num, n, subrow, subcol)) {
-			/* Place 'num' at (row, col) */
-			grid[row][col] = num;
+	box = (int)sqrt(n);
+	for (row = 0; row < n; row++) {
+		for (col = 0; col < n; col++) {
+			for (value = 0; value < n; value++)
+				table->keys[(row * n + col) * n + value] =
+					parts[row * n + col] ^
+					parts[n * n + row * n + value] ^
+					parts[2 * n * n + col * n + value] ^
+					parts[3 * n * n +
+					      ((row / box) * box + col / box) *
+					      n + value];
+		}
+	}
 
-			/* Recur to fill the rest of the grid */
-			if (solve_sudoku(grid, n, subrow, subcol)) {
-				free(numbers);
-				return 1;
-			}
+	free(parts);
+	return table;
+}
 
-			/* If placing 'num' doesn't lead to a solution, reset and try another number */
-			grid[row][col] = 0;
+void free_table(struct transposition_table *table)
+{
+	if (table == NULL)
+		return;
+
+	free(table->entries);
+	free(table->keys);
+	free(table);
+}
+
+/* Hash the values already on the board, and keep hashing from now on */
+void hash_board(struct board *board, const struct transposition_table *table)
+{
+	int cell;
+
+	board->keys = table->keys;
+	board->hash = 0;
+	for (cell = 0; cell < board->n * board->n; cell++)
+		if (board->cells[cell] != 0)
+			board->hash ^= table->keys[cell * board->n +
+						   board->cells[cell] - 1];
+}
+
+/*
+ * Count the solutions of the board, up to a limit, copying the first one
+ * found to first. The count of every subtree fully searched is kept in
+ * the table, if there is one, and read back when the same empty cells
+ * and masks turn up again; dead ends are counts of zero.
+ *
+ * @return The number of solutions, at most limit
+ */
+unsigned long count_solutions(struct board *board,
+			      struct transposition_table *table,
+			      unsigned long limit, struct board *first)
+{
+	struct table_entry *entry;
+	unsigned long legal;
+	unsigned long bit;
+	unsigned long total;
+	int cell, box;
+	int count;
+
+	count = pick_cell(board, &cell, &box, &legal);
+	if (count == 0)
+		return 0;
+
+	/* A full board, keep it if it's the first */
+	if (count < 0) {
+		if (first->n == 0)
+			*first = *board;
+		return 1;
+	}
+
+	entry = NULL;
+	if (table != NULL) {
+		entry = &table->entries[board->hash & table->mask];
+		if (entry->count != 0 && entry->hash == board->hash) {
+			table->hits++;
+			return entry->count - 1 < limit ? entry->count - 1 :
+							  limit;
 		}
 	}
 
-	free(numbers);
-	/* If no number can be placed, backtrack */
-	return 0;
-}
\ No newline at end of file
+	total = 0;
+	for (; legal != 0 && total < limit; legal &= legal - 1) {
+		bit = legal & (~legal + 1);
+		set_value(board, cell, box, bit);
+		total += count_solutions(board, table, limit - total, first);
+		clear_value(board, cell, box, bit);
+	}
+
+	/* A subtree cut short by the limit has no exact count */
+	if (entry != NULL && total < limit) {
+		entry->hash = board->hash;
+		entry->count = total + 1;
+		table->stores++;
+	}
+
+	return total;
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "grade.h"
+
+struct solver_profile;
+
+/* Puzzle slots in the pipeline, for each solver thread */
+#define BATCH_SLOTS_PER_THREAD 16
+
+/* What a batch reports about its puzzles */
+struct batch_summary {
+	int solved;		/* Puzzles completely solved */
+	int difficulties[N_DIFFICULTIES];	/* Puzzles of each difficulty */
+};
+
+/**
+ * Solves every puzzle of a file with a three stage pipeline: a parser
+ * thread, n_threads solver threads and the calling thread as the writer.
+ * The stages share a bounded ring of preallocated puzzle slots, so memory
+ * stays the same however long the input is: the parser waits for the
+ * writer to free a slot, the solvers claim the parsed ones and the writer
+ * outputs them in input order.
+ *
+ * @param input The file to read the puzzles from
+ * @param output The file to write the proposed grids to, or NULL
+ * @param grades The file to write the grade of each puzzle to, or NULL
+ * @param n The size of the puzzles
+ * @param fish_size Biggest fish searched for
+ * @param all_different Non-zero to run the all-different matching
+ * @param n_threads Number of solver threads
+ * @param simd Non-zero to run 9x9 puzzles through simd_solve()
+ * @param summary Set to the counts of solved puzzles and difficulties
+ * @param profile Where to add the profile of every solver, or NULL
+ * @return 0 on success, -1 on error
+ */
+int solve_batch(FILE *input, FILE *output, FILE *grades, int n,
+		int fish_size, int all_different, int n_threads, int simd,
+		struct batch_summary *summary, struct solver_profile *profile);
+
+#endif /* BATCH_H */
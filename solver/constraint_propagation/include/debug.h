@@ -6,16 +6,12 @@
 /* Include necessary headers only when DEBUG is defined */
 #ifdef DEBUG
 #include <stdio.h>
-#include "linked_list.h"
 #include "solver.h"
 #include "sudoku_utils.h"
 
 /* DPRINTF: Prints debug messages */
 #define DPRINTF(...) printf(__VA_ARGS__)
 
-/* DPRINT_LIST: Prints the linked list */
-#define DPRINT_LIST(...) print_list(__VA_ARGS__)
-
 /* DPRINT_EXTENDED_GRID: Prints the extended grid representing
  * the sudoku puzzle with all the possible candidates.
  */
@@ -28,7 +24,6 @@
 
 /* Define macros as empty statements when DEBUG is not defined */
 #define DPRINTF(...) do {} while (0)
-#define DPRINT_LIST(...) do {} while (0)
 #define DPRINT_EXTENDED_GRID(...) do {} while (0)
 #define DPRINT_SUDOKU(...) do {} while (0)
 
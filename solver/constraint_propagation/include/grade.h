@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef GRADE_H
+#define GRADE_H
+
+#include "solver.h"
+
+/* Difficulty of a puzzle, from the hardest step its solve needed */
+enum difficulty {
+	DIFFICULTY_EASY,	/* Naked and hidden singles */
+	DIFFICULTY_MEDIUM,	/* Box-line intersections */
+	DIFFICULTY_HARD,	/* Subsets, or all-different matching */
+	DIFFICULTY_EXPERT,	/* Fish */
+	DIFFICULTY_EXTREME,	/* Guesses */
+	N_DIFFICULTIES
+};
+
+/**
+ * Grade of a puzzle, read from the trace of its solve. Since propagate()
+ * only escalates to a technique once the cheaper ones are stuck, the
+ * hardest technique that made progress is one the puzzle really needs.
+ */
+struct puzzle_grade {
+	unsigned long uses[N_TECHNIQUES];	/* Passes that made progress */
+	unsigned long branches;		/* Cells the search guessed on */
+	int hardest;		/* Hardest technique used, -1 if none */
+	int difficulty;
+	unsigned long score;	/* Weighted uses and branches */
+};
+
+/**
+ * Grades the puzzle last solved with the context.
+ */
+void read_grade(const struct solver_context *context,
+		struct puzzle_grade *grade);
+
+/**
+ * Fills hardest, difficulty and score from the uses and branches.
+ */
+void finish_grade(struct puzzle_grade *grade);
+
+const char *difficulty_name(int difficulty);
+
+/**
+ * Writes a grade as a line of text: difficulty, score, hardest technique
+ * and branch points.
+ */
+void write_grade_to_file(const struct puzzle_grade *grade, FILE *file);
+
+#endif /* GRADE_H */
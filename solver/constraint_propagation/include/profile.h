@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+#include "solver.h"
+
+/* Search depths accounted separately, deeper ones share the last row */
+#define PROFILE_DEPTHS 32
+
+/**
+ * What one technique cost and earned at one search depth. A call is one
+ * pass of the technique over the whole grid.
+ */
+struct technique_stats {
+	unsigned long calls;
+	double time;		/* Wall time, in seconds */
+	unsigned long eliminations;	/* Candidates removed */
+	unsigned long resolved;	/* Cells left with a single candidate */
+};
+
+/* Kinds of subsets accounted by tuple size */
+#define PROFILE_NAKED	0
+#define PROFILE_HIDDEN	1
+
+/**
+ * What the naked or hidden subset search did with subsets of one size,
+ * from 2 to MAX_TUPLE_SIZE. A subset is a union of cells or of values
+ * that was computed; a tuple is one that closed.
+ */
+struct tuple_stats {
+	unsigned long subsets;
+	unsigned long tuples;
+	unsigned long eliminations;	/* Candidates the tuples removed */
+};
+
+/**
+ * Counters of a single solver context, so each thread updates its own.
+ * Merge them with profile_merge() once the batch is over.
+ */
+struct solver_profile {
+	struct technique_stats stats[PROFILE_DEPTHS][N_TECHNIQUES];
+	struct tuple_stats tuples[2][MAX_TUPLE_SIZE + 1];
+};
+
+/**
+ * Monotonic wall clock, in seconds from an arbitrary origin.
+ */
+double profile_clock(void);
+
+void profile_reset(struct solver_profile *profile);
+
+/**
+ * Adds the counters of src to dst.
+ */
+void profile_merge(struct solver_profile *dst,
+		   const struct solver_profile *src);
+
+/**
+ * Adds only the subset counters of src to dst, as the unit pool does
+ * after each pass.
+ */
+void profile_merge_tuples(struct solver_profile *dst,
+			  const struct solver_profile *src);
+
+/**
+ * Prints a row for each technique and depth that was used, followed by
+ * the totals of each technique, then a row for each kind and size of
+ * subset that was looked at.
+ */
+void profile_print_table(const struct solver_profile *profile, FILE *file);
+
+/**
+ * Prints the same data as profile_print_table() as a JSON document.
+ */
+void profile_print_json(const struct solver_profile *profile, FILE *file);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+struct solver_context;
+struct puzzle_grade;
+
+/* Puzzles propagated together, one per 16-bit lane */
+#define SIMD_LANES 16
+
+/* The only size the kernel handles */
+#define SIMD_SIZE 9
+
+/**
+ * Solves 9x9 puzzles SIMD_LANES at a time. Their candidate masks are laid
+ * out as one vector per cell, a lane per puzzle, and naked singles, hidden
+ * singles and box-line intersections run on every lane at once. A lane is
+ * refilled with the next puzzle as soon as its own is solved or stalls;
+ * the stalled ones are finished by the scalar solver from what the kernel
+ * deduced.
+ *
+ * Lanes escalate from naked singles to hidden singles to intersections the
+ * way the scalar schedule does, so a puzzle gets the same difficulty and
+ * hardest technique as from the scalar solver. Scores differ a little, the
+ * kernel counts its rounds rather than the scalar passes.
+ *
+ * @param grids The puzzles, filled in place with their solutions
+ * @param count Number of puzzles
+ * @param context A context for 9x9 puzzles, for the scalar path
+ * @param grades Filled with the grade of each puzzle, or NULL
+ * @return 0 on success, -1 if the scalar solver failed
+ */
+int simd_solve(int ***grids, int count, struct solver_context *context,
+	       struct puzzle_grade *grades);
+
+#endif /* SIMD_H */
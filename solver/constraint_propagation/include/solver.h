@@ -1,49 +1,300 @@
 #ifndef SOLVER_H
 #define SOLVER_H
-struct coordinates {
-	int row;
-	int column;
+
+struct solver_profile;
+struct unit_pool;
+
+/*
+ * Propagation techniques, from the cheapest to the most expensive. From
+ * all-different on they look at whole subsets of cells or lines, which
+ * costs far more than what they usually find, so their passes back off
+ * while they find nothing.
+ */
+enum technique {
+	TECHNIQUE_NAKED_SINGLES,
+	TECHNIQUE_HIDDEN_SINGLES,
+	TECHNIQUE_INTERSECTION_REMOVAL,
+	TECHNIQUE_ALL_DIFFERENT,
+	TECHNIQUE_NAKED_CANDIDATES,
+	TECHNIQUE_HIDDEN_CANDIDATES,
+	TECHNIQUE_FISH,
+	N_TECHNIQUES
+};
+
+/* Bits in a word of a bitset */
+#define BITS_PER_WORD ((int)(8 * sizeof(unsigned long)))
+
+/* Words of a bitset of n bits */
+#define BITSET_WORDS(n) (((n) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+/**
+ * Per-unit tables. Units are numbered with the n rows first, then the n
+ * columns, then the n boxes. For every unit and every value the positions
+ * table holds the bitset of the unit's cells that still allow that value,
+ * starting at word [(unit * n + value - 1) * words]. Bit k of an entry is
+ * the k-th cell of the unit: column k for a row, row k for a column and the
+ * k-th cell in row-major order for a box.
+ *
+ * Every bitset, candidates included, takes words words, one for puzzles up
+ * to 64x64.
+ */
+struct unit_tables {
+	int words;		/* Words of a bitset */
+	unsigned long *positions;	/* Value positions, 3n x n bitsets */
+	int *cells;		/* Cell (row * n + col) of each unit slot, 3n x n */
+	int *units;		/* Row, column and box unit of each cell, n^2 x 3 */
+	int *slots;		/* Slot of each cell in those units, n^2 x 3 */
+	int all_different;	/* Non-zero to run all_different() */
+	int sqrt_n;		/* Side of a box */
+
+	/* Intersection bitsets, sqrt_n of each */
+	unsigned long *segments;	/* Slots of a line inside its k-th box */
+	unsigned long *box_rows;	/* Slots of a box on its k-th row */
+	unsigned long *box_columns;	/* Slots of a box on its k-th column */
+
+	/* For the subset searches in progress */
+	int *scratch;		/* n entries */
+	int *stack;		/* Members of the subset, n entries */
+	unsigned long *unions;	/* Union at each subset size, n + 1 bitsets */
+	unsigned long *members;	/* One bitset */
+
+	/*
+	 * For all_different(): the value matched to each slot of each unit,
+	 * 3n x n, -1 if none, kept from one pass to the next so that only
+	 * the slots that lost their value need matching again. Then the
+	 * scratch of a pass, 6n entries.
+	 */
+	int *matching;
+	int *graph;
+
+	/*
+	 * Cells left with a single candidate whose value has not been
+	 * removed from their peers yet. A cell is pushed once per search
+	 * path, so n^2 entries suffice.
+	 */
+	int *singles;
+	int singles_size;
+
+	/* Set when a cell or a unit value runs out of candidates */
+	int contradiction;
+
+	/*
+	 * Live yield of the techniques: passes in a row that changed
+	 * nothing, and passes still to skip because of them.
+	 */
+	int misses[N_TECHNIQUES];
+	int skips[N_TECHNIQUES];
+
+	/* Trace of the solve, read by read_grade() */
+	unsigned long uses[N_TECHNIQUES];	/* Passes that made progress */
+	unsigned long branches;		/* Cells the search guessed on */
+
+	/*
+	 * Every candidate removed, in order, as cell * n + value - 1. A
+	 * candidate is removed at most once along a search path, so n^3
+	 * entries always suffice.
+	 */
+	int *trail;
+	int trail_size;
+
+	/* Running totals of eliminate_candidates(), sampled by the profile */
+	unsigned long eliminated;	/* Candidates removed */
+	unsigned long resolved;		/* Cells left with a single one */
+	struct solver_profile *profile;	/* Where to account, or NULL */
+
+	/*
+	 * Set only in the copies of the tables the unit pool workers run
+	 * on: removed candidates are recorded there, as cell * n + value - 1,
+	 * for the pool to apply once every worker is done.
+	 */
+	int *deferred;
+	int deferred_size;
+	int deferred_capacity;
+
+	struct unit_pool *pool;		/* Runs passes on threads, or NULL */
 };
 
-int sudoku_solver(int **grid, int n);
+/**
+ * Everything the solver needs for puzzles of one size, carved out of a
+ * single buffer. Create one per thread and reuse it for every puzzle:
+ * extend_grid() resets it, so solving allocates nothing.
+ */
+struct solver_context {
+	int n;			/* Size of the puzzles */
+	int fish_size;		/* Biggest fish searched for */
+	unsigned long *extended_grid;	/* Candidate bitset of each cell */
+	struct unit_tables tables;
+	void *buffer;		/* Backing memory of all the arrays */
+};
+
+/* Most passes a subset search sits out after finding nothing */
+#define MAX_SKIPS 63
+
+/*
+ * Biggest puzzle side. The trail takes n^3 ints, which dominates the size
+ * of a context: about 5 MB at this size.
+ */
+#define MAX_SIZE 100
+
+/* Default size limit of the fish search (jellyfish) */
+#define DEFAULT_FISH_SIZE 4
+
+/*
+ * Biggest naked or hidden tuple searched for (quads). The number of
+ * subsets grows too fast with the size of the units to go further on big
+ * puzzles, and bigger tuples hardly ever turn up in practice.
+ */
+#define MAX_TUPLE_SIZE 4
+
+/**
+ * Allocates a solver context for puzzles of size n.
+ *
+ * @param n The size of the puzzles
+ * @param fish_size Biggest fish searched for, 0 or 1 to disable them
+ * @return The context, or NULL if allocation fails
+ */
+struct solver_context *create_solver_context(int n, int fish_size);
+
+void free_solver_context(struct solver_context *context);
+
+/**
+ * Solves the puzzle with constraint propagation, branching on the cell
+ * with the fewest candidates whenever propagation stalls.
+ *
+ * The search is a plain depth-first one, the same branching order every
+ * time, with no restarts and no limit on the guesses. Puzzles made by
+ * propagation or the generator solve in milliseconds, but a big grid with
+ * many blanks picked at random can send it down a wrong early guess whose
+ * subtree it has to exhaust: on 36x36 grids with about half the cells
+ * blank, some take minutes. Give such puzzles a time limit of their own.
+ *
+ * @param context A context for the size of the puzzle
+ * @param grid The puzzle, filled in place with the solution
+ * @return 1 if solved, 0 if the puzzle has no solution, -1 on error
+ */
+int sudoku_solver(struct solver_context *context, int **grid);
+
+/**
+ * Runs the propagation techniques until none of them changes the grid,
+ * escalating from the cheapest to the most expensive only while the
+ * cheaper ones make no progress. When the tables have a profile, every
+ * pass of a technique is accounted at the given search depth.
+ *
+ * @return 0 if the grid reached a contradiction, 1 otherwise
+ */
+int propagate(unsigned long *extended_grid, struct unit_tables *tables, int n,
+	      int fish_size, int depth);
 
-struct node ***extend_grid(int **grid, int n);
+/**
+ * Removes the candidates a unit pool worker recorded, skipping the ones
+ * already gone.
+ *
+ * @return Number of candidates removed
+ */
+int apply_deferred(unsigned long *extended_grid, struct unit_tables *tables,
+		   int n, const int *deferred, int size);
 
-void initialize_propagation_matrix(int **matrix, int n);
+/**
+ * Number of independent items a pass of a technique goes through: units,
+ * boxes or values. Naked singles work from their queue and have none.
+ */
+int technique_items(int technique, int n);
 
-/* Naked candidates */
+/**
+ * Runs a technique on the items first, first + step, first + 2 * step...
+ * of a pass, see technique_items().
+ *
+ * @return Non-zero if it changed the grid
+ */
+int run_technique_items(unsigned long *extended_grid,
+			struct unit_tables *tables, int n, int fish_size,
+			int technique, int first, int step);
 
-int naked_candidates_rows(struct node ***extended_grid, int n,
-			  int **already_propagated, int depth);
+/**
+ * Checks for a cell without candidates or a unit value without places.
+ */
+int has_contradiction(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n);
 
-int naked_candidates_columns(struct node ***extended_grid, int n,
-			     int **already_propagated, int depth);
+/**
+ * Depth-first search: propagates, then guesses each candidate of the
+ * unresolved cell with the fewest of them, restoring the grid on failure.
+ *
+ * @return 1 if a solution was found, 0 if none exists, -1 on error
+ */
+int search_solution(unsigned long *extended_grid, struct unit_tables *tables,
+		    int n, int fish_size, int depth);
 
-int naked_candidates_boxes(struct node ***extended_grid, int n,
-			   int **already_propagated, int depth);
+/**
+ * Loads a puzzle in the context. The extended grid holds one candidate
+ * bitset per cell, stored row by row, where bit k set means value k + 1
+ * is still possible in the cell; the position tables are rebuilt from it
+ * and the trail is emptied.
+ */
+void extend_grid(struct solver_context *context, int **grid);
 
-/* Propagations for naked candidates */
+/**
+ * Removes the candidates of a bitset from a cell, keeping the unit tables up
+ * to date and recording the change on the trail. A cell left with one
+ * candidate is queued for naked_singles(), one left with none or a unit
+ * value left without places sets the contradiction flag.
+ *
+ * @return The number of candidates actually removed
+ */
+int eliminate_candidates(unsigned long *extended_grid,
+			 struct unit_tables *tables, int n, int cell,
+			 const unsigned long *mask);
 
-void propagate_row(struct node ***extended_grid, int n,
-		   struct coordinates *coord, int n_coordinates, int value);
+/**
+ * Reverts every elimination recorded on the trail after the given mark,
+ * a value of trail_size taken earlier.
+ */
+void undo_eliminations(unsigned long *extended_grid,
+		       struct unit_tables *tables, int n, int mark);
 
-void propagate_column(struct node ***extended_grid, int n,
-		      struct coordinates *coord, int n_coordinates, int value);
+/* Naked singles, from the queue of resolved cells */
 
-void propagate_box(struct node ***extended_grid, int n,
-		   struct coordinates *coord, int n_coordinates, int value);
+int naked_singles(unsigned long *extended_grid, struct unit_tables *tables,
+		  int n);
+
+/* Naked candidates, tuples of two cells or more */
+
+int naked_candidates(unsigned long *extended_grid, struct unit_tables *tables,
+		     int n, int unit);
 
 /*Hidden singles*/
 
-int hidden_singles(struct node ***extended_grid, int n);
+int hidden_singles(unsigned long *extended_grid, struct unit_tables *tables,
+		   int n);
+
+/* Intersection removal (pointing and claiming) */
+
+int intersection_removal(unsigned long *extended_grid,
+			 struct unit_tables *tables, int n, int box);
+
+/* Hidden candidates */
+
+int hidden_candidates(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n, int unit);
+
+/*
+ * All-different matching (Regin), the naked and hidden tuples of every size
+ * at once
+ */
+
+int all_different(unsigned long *extended_grid, struct unit_tables *tables,
+		  int n, int unit);
 
-int check_hidden_single(struct node ***extended_grid, int n, int row, int col,
-			int value);
+/* Fish (X-Wing, Swordfish, Jellyfish, ...) */
 
-void print_extended_grid(struct node ***extended_grid, int n);
+int fish(unsigned long *extended_grid, struct unit_tables *tables, int n,
+	 int value, int max_size);
 
-void free_extended_grid(struct node ***extended_grid, int n);
+/**
+ * Name of a technique of enum technique, as used in the reports.
+ */
+const char *technique_name(int technique);
 
-void free_propagation_matrix(int ***propagation, int n);
+void print_extended_grid(unsigned long *extended_grid, int n);
 
 #endif /* SOLVER_H */
@@ -25,10 +25,22 @@ void free_grid(int **grid, int n);
  * @param grid Pre-allocated grid to store the puzzle
  * @param file The file to read the grid from
  * @param n The size of the grid
+ * Values outside 0..n are an error, 0 being an empty cell.
+ *
  * @returns 0 if read goes alright, 1 if reached EOF, -1 if error
  */
 int read_grid_from_file(int **grid, FILE *file, int n);
 
+/**
+ * Writes a Sudoku grid as a single line of text, in the format read back
+ * by read_grid_from_file().
+ *
+ * @param grid The grid to write
+ * @param file The file to write the grid to
+ * @param n The size of the grid
+ */
+void write_grid_to_file(int **grid, FILE *file, int n);
+
 /**
  * Check if the sudoku has been completely solved.
  *
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#ifndef UNIT_POOL_H
+#define UNIT_POOL_H
+
+struct solver_context;
+struct unit_tables;
+
+/**
+ * Threads sharing the passes of a single puzzle. A pass of a technique
+ * goes through the units, boxes or values of the grid one at a time, and
+ * the pool deals them out round-robin to its threads, the caller being
+ * one of them.
+ *
+ * A worker runs the technique on its own copy of the candidates and only
+ * records what it would remove, so during a pass the shared grid, unit
+ * tables and trail are read but never written. Once every worker is
+ * done, the calling thread applies the eliminations in worker order.
+ * Every deduction made from the grid at the start of the pass stays
+ * valid however many other candidates go, and the split of the items
+ * only depends on the number of threads, so a puzzle is solved the same
+ * way every time with the same number of threads.
+ *
+ * A pass that applies nothing until its end finds less than a serial one
+ * applying each elimination at once, and a worker sees what its own
+ * earlier items removed but not what the others did. Puzzles take more
+ * passes than without the pool, and how many depends on the number of
+ * threads. Grade scores count those passes, so they depend on the number
+ * of threads too. Solutions and difficulties don't.
+ *
+ * When the context has a profile, the subsets each worker looked at are
+ * added to it after the pass. A candidate that two workers would both
+ * remove counts among the tuple eliminations of each.
+ *
+ * Only pays off on boards big enough for a pass to outweigh waking the
+ * threads, 36x36 and up.
+ */
+struct unit_pool;
+
+/**
+ * Starts a pool of threads for the passes of a context, which owns it from
+ * then on: free_solver_context() stops it.
+ *
+ * @param context The context to run the passes of
+ * @param n_threads Threads sharing each pass, the caller included
+ * @return The pool, or NULL on error
+ */
+struct unit_pool *create_unit_pool(struct solver_context *context,
+				   int n_threads);
+
+/**
+ * Stops the threads of a pool and frees it. NULL is ignored.
+ */
+void free_unit_pool(struct unit_pool *pool);
+
+/**
+ * Runs one pass of a technique with every thread of the pool.
+ *
+ * @return Number of candidates removed
+ */
+int unit_pool_run(struct unit_pool *pool, unsigned long *extended_grid,
+		  struct unit_tables *tables, int n, int fish_size,
+		  int technique);
+
+#endif /* UNIT_POOL_H */
@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/batch.h"
+#include "../include/debug.h"
+#include "../include/grade.h"
+#include "../include/profile.h"
+#include "../include/simd.h"
+#include "../include/solver.h"
+#include "../include/sudoku_utils.h"
+
+/* Keeps the cursors written by different stages on different cache lines */
+#define CACHE_LINE 64
+
+struct batch_slot {
+	int **grid;
+	int solved;		/* Set by the solver, cleared by the writer */
+	struct puzzle_grade grade;	/* Filled by the solver */
+};
+
+/**
+ * Ring of puzzle slots shared by the stages. The puzzle with sequence
+ * number k lives in slot k % n_slots and goes through three cursors, each
+ * advanced by a single stage and only read by the others:
+ *
+ *	written <= claimed <= produced <= written + n_slots
+ *
+ * The parser owns produced, the solvers take turns on claimed with a
+ * compare and swap, and the writer owns written.
+ */
+struct batch {
+	int n;
+	int simd;		/* Claim and solve SIMD_LANES puzzles at a time */
+	int n_slots;
+	struct batch_slot *slots;
+	FILE *input;
+
+	long produced;
+	int eof;		/* Set once produced is final */
+	int error;		/* Set if the input could not be parsed */
+	char pad0[CACHE_LINE];
+	long claimed;
+	char pad1[CACHE_LINE];
+	long written;
+	char pad2[CACHE_LINE];
+};
+
+struct batch_worker {
+	pthread_t thread;
+	struct batch *batch;
+	struct solver_context *context;
+	int error;		/* Set if the solver failed on some puzzle */
+	struct solver_profile profile;	/* Counters of this thread only */
+};
+
+#define LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/*
+ * Waits a little longer every time a stage finds nothing to do: spins
+ * first, then gives the processor away, then sleeps.
+ */
+static void backoff(int *round)
+{
+	struct timespec pause;
+
+	if (*round < 64) {
+		++*round;
+	} else if (*round < 128) {
+		++*round;
+		sched_yield();
+	} else {
+		pause.tv_sec = 0;
+		pause.tv_nsec = 50000;
+		nanosleep(&pause, NULL);
+	}
+}
+
+static void *batch_parser_main(void *arg)
+{
+	struct batch *batch;
+	long produced;
+	int read_status;
+	int round;
+
+	batch = (struct batch *)arg;
+
+	for (produced = 0;; ++produced) {
+		/* Wait for the writer to free the slot */
+		round = 0;
+		while (produced - LOAD(&batch->written) >= batch->n_slots)
+			backoff(&round);
+
+		read_status = read_grid_from_file(
+			batch->slots[produced % batch->n_slots].grid,
+			batch->input, batch->n);
+		if (read_status != 0) {
+			if (read_status == 1) {
+				DPRINTF("Reached EOF\n");
+			} else {
+				fprintf(stderr, "Error: Failed to read grid from file\n");
+				batch->error = 1;
+			}
+			break;
+		}
+
+		STORE(&batch->produced, produced + 1);
+	}
+
+	STORE(&batch->eof, 1);
+	return NULL;
+}
+
+static void *batch_solver_main(void *arg)
+{
+	struct batch_worker *worker;
+	struct batch *batch;
+	struct batch_slot *slot;
+	int **grids[SIMD_LANES];
+	struct puzzle_grade grades[SIMD_LANES];
+	long claimed;
+	long available;
+	int taken;
+	int round;
+	int i;
+
+	worker = (struct batch_worker *)arg;
+	batch = worker->batch;
+
+	round = 0;
+	while (1) {
+		claimed = LOAD(&batch->claimed);
+		available = LOAD(&batch->produced) - claimed;
+		if (available <= 0) {
+			/* Read eof before produced, then it is final */
+			if (LOAD(&batch->eof) &&
+			    claimed >= LOAD(&batch->produced))
+				return NULL;
+			backoff(&round);
+			continue;
+		}
+
+		/* The kernel takes a run of puzzles, the scalar path one */
+		taken = 1;
+		if (batch->simd)
+			taken = available < SIMD_LANES ? available : SIMD_LANES;
+
+		if (!__atomic_compare_exchange_n(&batch->claimed, &claimed,
+						 claimed + taken, 0,
+						 __ATOMIC_ACQ_REL,
+						 __ATOMIC_ACQUIRE))
+			continue;
+
+		round = 0;
+		for (i = 0; i < taken; ++i)
+			grids[i] = batch->slots[(claimed + i) %
+						batch->n_slots].grid;
+
+		if (batch->simd) {
+			if (simd_solve(grids, taken, worker->context,
+				       grades) < 0)
+				worker->error = 1;
+		} else {
+			if (sudoku_solver(worker->context, grids[0]) < 0)
+				worker->error = 1;
+			read_grade(worker->context, &grades[0]);
+		}
+
+		for (i = 0; i < taken; ++i) {
+			slot = &batch->slots[(claimed + i) % batch->n_slots];
+			slot->grade = grades[i];
+			STORE(&slot->solved, 1);
+		}
+	}
+}
+
+/*
+ * Outputs the puzzles in input order, handing each slot back to the parser
+ * as soon as it is written.
+ */
+static void batch_writer(struct batch *batch, FILE *output, FILE *grades,
+			 struct batch_summary *summary)
+{
+	struct batch_slot *slot;
+	long written;
+	int round;
+
+	for (written = 0;; ++written) {
+		slot = &batch->slots[written % batch->n_slots];
+
+		round = 0;
+		while (!LOAD(&slot->solved)) {
+			if (LOAD(&batch->eof) &&
+			    written >= LOAD(&batch->produced))
+				return;
+			backoff(&round);
+		}
+
+		DPRINTF("The proposed grid:\n");
+		DPRINT_SUDOKU(slot->grid, batch->n);
+
+		if (output != NULL)
+			write_grid_to_file(slot->grid, output, batch->n);
+		if (grades != NULL)
+			write_grade_to_file(&slot->grade, grades);
+		if (check_solved(slot->grid, batch->n))
+			++summary->solved;
+		++summary->difficulties[slot->grade.difficulty];
+
+		slot->solved = 0;
+		STORE(&batch->written, written + 1);
+	}
+}
+
+int solve_batch(FILE *input, FILE *output, FILE *grades, int n,
+		int fish_size, int all_different, int n_threads, int simd,
+		struct batch_summary *summary, struct solver_profile *profile)
+{
+	struct batch batch;
+	struct batch_worker *workers;
+	pthread_t parser;
+	int n_started;
+	int status;
+	int i;
+
+	status = 0;
+	memset(summary, 0, sizeof(*summary));
+
+	batch.n = n;
+	batch.simd = simd;
+	batch.n_slots = n_threads * BATCH_SLOTS_PER_THREAD;
+	batch.input = input;
+	batch.produced = 0;
+	batch.eof = 0;
+	batch.error = 0;
+	batch.claimed = 0;
+	batch.written = 0;
+
+	/* Allocate every puzzle slot and every context up front */
+	batch.slots = (struct batch_slot *)calloc(batch.n_slots,
+						  sizeof(struct batch_slot));
+	workers = (struct batch_worker *)calloc(n_threads,
+						sizeof(struct batch_worker));
+	if (batch.slots == NULL || workers == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory for batch\n");
+		status = -1;
+		goto out_free;
+	}
+
+	for (i = 0; i < batch.n_slots; ++i) {
+		batch.slots[i].grid = create_grid(n);
+		if (batch.slots[i].grid == NULL) {
+			fprintf(stderr, "Error: Failed to allocate memory for grid\n");
+			status = -1;
+			goto out_free;
+		}
+	}
+
+	for (i = 0; i < n_threads; ++i) {
+		workers[i].batch = &batch;
+		workers[i].context = create_solver_context(n, fish_size);
+		if (workers[i].context == NULL) {
+			fprintf(stderr, "Error: Failed to allocate memory for solver\n");
+			status = -1;
+			goto out_free;
+		}
+		workers[i].context->tables.all_different = all_different;
+		if (profile != NULL)
+			workers[i].context->tables.profile =
+				&workers[i].profile;
+	}
+
+	for (n_started = 0; n_started < n_threads; ++n_started) {
+		if (pthread_create(&workers[n_started].thread, NULL,
+				   batch_solver_main, &workers[n_started]) != 0) {
+			fprintf(stderr, "Error: Failed to start solver thread\n");
+			status = -1;
+			break;
+		}
+	}
+
+	if (status == 0 &&
+	    pthread_create(&parser, NULL, batch_parser_main, &batch) != 0) {
+		fprintf(stderr, "Error: Failed to start parser thread\n");
+		status = -1;
+	}
+
+	if (status == 0) {
+		batch_writer(&batch, output, grades, summary);
+		pthread_join(parser, NULL);
+		if (batch.error)
+			status = -1;
+	} else {
+		/* Nothing was parsed, let the solvers go */
+		STORE(&batch.eof, 1);
+	}
+
+	for (i = 0; i < n_started; ++i) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].error)
+			status = -1;
+		if (profile != NULL)
+			profile_merge(profile, &workers[i].profile);
+	}
+
+out_free:
+	if (workers != NULL)
+		for (i = 0; i < n_threads; ++i)
+			free_solver_context(workers[i].context);
+	if (batch.slots != NULL)
+		for (i = 0; i < batch.n_slots; ++i)
+			if (batch.slots[i].grid != NULL)
+				free_grid(batch.slots[i].grid, n);
+	free(workers);
+	free(batch.slots);
+	return status;
+}
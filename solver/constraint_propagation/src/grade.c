@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/grade.h"
+
+static const char *difficulty_names[N_DIFFICULTIES] = {
+	"easy",
+	"medium",
+	"hard",
+	"expert",
+	"extreme",
+};
+
+/* Difficulty a puzzle gets when a technique is the hardest it needs */
+static const int technique_difficulty[N_TECHNIQUES] = {
+	DIFFICULTY_EASY,	/* Naked singles */
+	DIFFICULTY_EASY,	/* Hidden singles */
+	DIFFICULTY_MEDIUM,	/* Intersection removal */
+	DIFFICULTY_HARD,	/* All-different matching */
+	DIFFICULTY_HARD,	/* Naked candidates */
+	DIFFICULTY_HARD,	/* Hidden candidates */
+	DIFFICULTY_EXPERT,	/* Fish */
+};
+
+/* Score of one productive pass of each technique, and of one guess */
+static const unsigned long technique_weight[N_TECHNIQUES] = {
+	1, 2, 10, 30, 30, 40, 80
+};
+#define BRANCH_WEIGHT 200
+
+void read_grade(const struct solver_context *context,
+		struct puzzle_grade *grade)
+{
+	memcpy(grade->uses, context->tables.uses, sizeof(grade->uses));
+	grade->branches = context->tables.branches;
+	finish_grade(grade);
+}
+
+void finish_grade(struct puzzle_grade *grade)
+{
+	int technique;
+
+	grade->hardest = -1;
+	grade->score = grade->branches * BRANCH_WEIGHT;
+	for (technique = 0; technique < N_TECHNIQUES; ++technique) {
+		if (grade->uses[technique] == 0)
+			continue;
+
+		grade->hardest = technique;
+		grade->score += grade->uses[technique] *
+				technique_weight[technique];
+	}
+
+	if (grade->branches > 0)
+		grade->difficulty = DIFFICULTY_EXTREME;
+	else if (grade->hardest >= 0)
+		grade->difficulty = technique_difficulty[grade->hardest];
+	else
+		grade->difficulty = DIFFICULTY_EASY;
+}
+
+const char *difficulty_name(int difficulty)
+{
+	return difficulty_names[difficulty];
+}
+
+void write_grade_to_file(const struct puzzle_grade *grade, FILE *file)
+{
+	fprintf(file, "%s %lu %s %lu\n", difficulty_name(grade->difficulty),
+		grade->score,
+		grade->hardest >= 0 ? technique_name(grade->hardest) : "none",
+		grade->branches);
+}
@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/profile.h"
+
+double profile_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void profile_reset(struct solver_profile *profile)
+{
+	memset(profile, 0, sizeof(struct solver_profile));
+}
+
+void profile_merge(struct solver_profile *dst,
+		   const struct solver_profile *src)
+{
+	int depth, technique; /* Loop variables */
+	struct technique_stats *to;
+	const struct technique_stats *from;
+
+	for (depth = 0; depth < PROFILE_DEPTHS; ++depth) {
+		for (technique = 0; technique < N_TECHNIQUES; ++technique) {
+			to = &dst->stats[depth][technique];
+			from = &src->stats[depth][technique];
+			to->calls += from->calls;
+			to->time += from->time;
+			to->eliminations += from->eliminations;
+			to->resolved += from->resolved;
+		}
+	}
+
+	profile_merge_tuples(dst, src);
+}
+
+void profile_merge_tuples(struct solver_profile *dst,
+			  const struct solver_profile *src)
+{
+	int kind, size; /* Loop variables */
+	struct tuple_stats *to;
+	const struct tuple_stats *from;
+
+	for (kind = 0; kind < 2; ++kind) {
+		for (size = 2; size <= MAX_TUPLE_SIZE; ++size) {
+			to = &dst->tuples[kind][size];
+			from = &src->tuples[kind][size];
+			to->subsets += from->subsets;
+			to->tuples += from->tuples;
+			to->eliminations += from->eliminations;
+		}
+	}
+}
+
+/* Technique whose subsets a kind of tuple_stats accounts */
+static const char *tuple_kind_name(int kind)
+{
+	return technique_name(kind == PROFILE_NAKED ?
+			      TECHNIQUE_NAKED_CANDIDATES :
+			      TECHNIQUE_HIDDEN_CANDIDATES);
+}
+
+/* Sums the counters of a technique over every depth */
+static void technique_totals(const struct solver_profile *profile,
+			     int technique, struct technique_stats *total)
+{
+	int depth; /* Loop variable */
+
+	memset(total, 0, sizeof(struct technique_stats));
+	for (depth = 0; depth < PROFILE_DEPTHS; ++depth) {
+		total->calls += profile->stats[depth][technique].calls;
+		total->time += profile->stats[depth][technique].time;
+		total->eliminations +=
+			profile->stats[depth][technique].eliminations;
+		total->resolved += profile->stats[depth][technique].resolved;
+	}
+}
+
+static void print_row(FILE *file, const char *name, const char *depth,
+		      const struct technique_stats *stats)
+{
+	fprintf(file, "%-22s %6s %12lu %12.6f %14lu %12lu\n", name, depth,
+		stats->calls, stats->time, stats->eliminations,
+		stats->resolved);
+}
+
+void profile_print_table(const struct solver_profile *profile, FILE *file)
+{
+	int depth, technique; /* Loop variables */
+	int kind, size; /* Loop variables */
+	const struct technique_stats *stats;
+	const struct tuple_stats *tuples;
+	struct technique_stats total;
+	char label[16];
+
+	fprintf(file, "%-22s %6s %12s %12s %14s %12s\n", "technique", "depth",
+		"calls", "time (s)", "eliminations", "resolved");
+
+	for (depth = 0; depth < PROFILE_DEPTHS; ++depth) {
+		for (technique = 0; technique < N_TECHNIQUES; ++technique) {
+			stats = &profile->stats[depth][technique];
+			if (stats->calls == 0)
+				continue;
+
+			sprintf(label, depth == PROFILE_DEPTHS - 1 ? "%d+" : "%d",
+				depth);
+			print_row(file, technique_name(technique), label,
+				  stats);
+		}
+	}
+
+	for (technique = 0; technique < N_TECHNIQUES; ++technique) {
+		technique_totals(profile, technique, &total);
+		print_row(file, technique_name(technique), "all", &total);
+	}
+
+	fprintf(file, "\n%-22s %6s %12s %12s %14s\n", "technique", "size",
+		"subsets", "tuples", "eliminations");
+	for (kind = 0; kind < 2; ++kind) {
+		for (size = 2; size <= MAX_TUPLE_SIZE; ++size) {
+			tuples = &profile->tuples[kind][size];
+			if (tuples->subsets == 0)
+				continue;
+
+			fprintf(file, "%-22s %6d %12lu %12lu %14lu\n",
+				tuple_kind_name(kind), size, tuples->subsets,
+				tuples->tuples, tuples->eliminations);
+		}
+	}
+}
+
+static void print_json_stats(FILE *file, const struct technique_stats *stats)
+{
+	fprintf(file,
+		"\"calls\": %lu, \"time\": %.9f, \"eliminations\": %lu, \"resolved\": %lu",
+		stats->calls, stats->time, stats->eliminations,
+		stats->resolved);
+}
+
+void profile_print_json(const struct solver_profile *profile, FILE *file)
+{
+	int depth, technique; /* Loop variables */
+	int kind, size; /* Loop variables */
+	const struct technique_stats *stats;
+	const struct tuple_stats *tuples;
+	struct technique_stats total;
+	int first;
+
+	fprintf(file, "{\n  \"techniques\": [\n");
+	for (technique = 0; technique < N_TECHNIQUES; ++technique) {
+		technique_totals(profile, technique, &total);
+		fprintf(file, "    {\"name\": \"%s\", ",
+			technique_name(technique));
+		print_json_stats(file, &total);
+		fprintf(file, ", \"depths\": [");
+
+		first = 1;
+		for (depth = 0; depth < PROFILE_DEPTHS; ++depth) {
+			stats = &profile->stats[depth][technique];
+			if (stats->calls == 0)
+				continue;
+
+			fprintf(file, "%s\n      {\"depth\": %d, ",
+				first ? "" : ",", depth);
+			print_json_stats(file, stats);
+			fprintf(file, "}");
+			first = 0;
+		}
+
+		fprintf(file, "%s]}%s\n", first ? "" : "\n    ",
+			technique + 1 < N_TECHNIQUES ? "," : "");
+	}
+	fprintf(file, "  ],\n  \"tuples\": [");
+
+	first = 1;
+	for (kind = 0; kind < 2; ++kind) {
+		for (size = 2; size <= MAX_TUPLE_SIZE; ++size) {
+			tuples = &profile->tuples[kind][size];
+			if (tuples->subsets == 0)
+				continue;
+
+			fprintf(file,
+				"%s\n    {\"technique\": \"%s\", \"size\": %d, \"subsets\": %lu, \"tuples\": %lu, \"eliminations\": %lu}",
+				first ? "" : ",", tuple_kind_name(kind), size,
+				tuples->subsets, tuples->tuples,
+				tuples->eliminations);
+			first = 0;
+		}
+	}
+	fprintf(file, "%s]\n}\n", first ? "" : "\n  ");
+}
@@ -1,36 +1,131 @@
 /* SPDX-License-Identifier: GPL-3.0 */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "../../include/batch.h"
 #include "../../include/debug.h"
+#include "../../include/grade.h"
+#include "../../include/profile.h"
+#include "../../include/simd.h"
 #include "../../include/solver.h"
 #include "../../include/sudoku_utils.h"
+#include "../../include/unit_pool.h"
 
 int main(int argc, char **argv)
 {
 	char *filename;
+	char *output_filename;
+	char *grades_filename;
+	char *profile_format;
+	char *kernel;
+	char *matching;
+	int arg;
 	int n;
+	int fish_size;
+	int all_different;
+	int n_threads;
+	int unit_threads;
+	int simd;
 	int sqrt_n;
 	int read_status;
-	int tot_solved;
+	int difficulty;
 	int **grid;
+	struct solver_context *context;
+	struct solver_profile profile;
+	struct puzzle_grade grade;
+	struct batch_summary summary;
 	FILE *file;
-	clock_t start_time;
-	clock_t end_time;
+	FILE *output;
+	FILE *grades;
+	struct timespec start_time;
+	struct timespec end_time;
 	double computation_time;
 
+	/* Parse the options */
+	fish_size = DEFAULT_FISH_SIZE;
+	n_threads = 0;
+	unit_threads = 1;
+	output_filename = NULL;
+	grades_filename = NULL;
+	profile_format = NULL;
+	kernel = NULL;
+	matching = NULL;
+	for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-f") == 0)
+			fish_size = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-j") == 0)
+			n_threads = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-u") == 0)
+			unit_threads = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-o") == 0)
+			output_filename = argv[arg + 1];
+		else if (strcmp(argv[arg], "-g") == 0)
+			grades_filename = argv[arg + 1];
+		else if (strcmp(argv[arg], "-p") == 0)
+			profile_format = argv[arg + 1];
+		else if (strcmp(argv[arg], "-k") == 0)
+			kernel = argv[arg + 1];
+		else if (strcmp(argv[arg], "-a") == 0)
+			matching = argv[arg + 1];
+		else
+			break;
+	}
+
 	/* Check if the correct number of arguments is passed */
-	if (argc != 3) {
-		fprintf(stderr, "Usage: %s <size> <filename>\n", argv[0]);
+	if (argc - arg != 2) {
+		fprintf(stderr,
+			"Usage: %s [-f fish_size] [-j threads] [-u threads] [-o output] [-g grades] [-p table|json] [-k scalar|simd] [-a on|off] <size> <filename>\n"
+			"  -u threads share the passes of each puzzle; grade scores depend on their number\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (kernel != NULL && strcmp(kernel, "scalar") != 0 &&
+	    strcmp(kernel, "simd") != 0) {
+		fprintf(stderr, "Error: Unknown kernel %s\n", kernel);
+		return 1;
+	}
+
+	if (matching != NULL && strcmp(matching, "on") != 0 &&
+	    strcmp(matching, "off") != 0) {
+		fprintf(stderr, "Error: -a takes on or off, not %s\n",
+			matching);
+		return 1;
+	}
+
+	/* All-different matching, stronger than the subsets on big units */
+	all_different = matching != NULL && strcmp(matching, "on") == 0;
+
+	if (profile_format != NULL && strcmp(profile_format, "table") != 0 &&
+	    strcmp(profile_format, "json") != 0) {
+		fprintf(stderr, "Error: Unknown profile format %s\n",
+			profile_format);
+		return 1;
+	}
+
+	if (n_threads < 0) {
+		fprintf(stderr, "Error: The number of threads can't be negative\n");
+		return 1;
+	}
+
+	/* Threads share the passes of one puzzle at a time, or solve many */
+	if (unit_threads < 1) {
+		fprintf(stderr, "Error: A puzzle needs at least one thread\n");
+		return 1;
+	}
+	if (unit_threads > 1 && (n_threads > 0 || kernel != NULL)) {
+		fprintf(stderr, "Error: -u only applies to the serial loop, without -j or -k\n");
 		return 1;
 	}
 
 	/* Read the size of the file from command line */
-	n = atoi(argv[1]);
+	n = atoi(argv[arg]);
 
 	/* Checks on puzzle size */
 	if (n < 1) {
@@ -38,48 +133,116 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	if (n > MAX_SIZE) {
+		fprintf(stderr, "Error: Puzzle size can't be bigger than %d\n", MAX_SIZE);
+		return 1;
+	}
+
 	sqrt_n = (int)sqrt(n);
 	if (sqrt_n * sqrt_n != n) {
 		fprintf(stderr, "Error: Size %d must be a perfect square (4, 9, 16, ...)\n", n);
 		return 1;
 	}
 
+	/* The SIMD kernel is a batch mode for 9x9 puzzles */
+	simd = kernel != NULL && strcmp(kernel, "simd") == 0;
+	if (simd && n != SIMD_SIZE) {
+		fprintf(stderr, "Error: The simd kernel only solves %dx%d puzzles\n",
+			SIMD_SIZE, SIMD_SIZE);
+		return 1;
+	}
+	if (simd && n_threads == 0)
+		n_threads = 1;
+
 	/* Parse the filename from command line */
-	filename = argv[2];
+	filename = argv[arg + 1];
 
-	/* Open the file */
+	/* Open the files */
 	file = fopen(filename, "r");
 	if (file == NULL) {
 		fprintf(stderr, "Error: Unable to open file %s\n", filename);
 		return 1;
 	}
 
-	/* Start timing the computation */
-	start_time = clock();
+	output = NULL;
+	if (output_filename != NULL) {
+		output = fopen(output_filename, "w");
+		if (output == NULL) {
+			fprintf(stderr, "Error: Unable to open file %s\n",
+				output_filename);
+			fclose(file);
+			return 1;
+		}
+	}
 
-	tot_solved = 0;
-	while (1) {
-		/* Allocate memory for the Sudoku grid */
-		grid = create_grid(n);
-		if (grid == NULL) {
-			fprintf(stderr, "Error: Failed to allocate memory for grid\n");
+	grades = NULL;
+	if (grades_filename != NULL) {
+		grades = fopen(grades_filename, "w");
+		if (grades == NULL) {
+			fprintf(stderr, "Error: Unable to open file %s\n",
+				grades_filename);
+			if (output != NULL)
+				fclose(output);
 			fclose(file);
 			return 1;
 		}
+	}
+
+	profile_reset(&profile);
+
+	/* Wall clock time, the workers run concurrently */
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	if (n_threads > 0) {
+		/* Parse, solve and write in a pipeline of threads */
+		if (solve_batch(file, output, grades, n, fish_size,
+				all_different, n_threads, simd, &summary,
+				profile_format != NULL ? &profile : NULL) != 0)
+			goto out_close;
+		goto out_report;
+	}
+
+	/* Allocate the grid and the solver once, they serve every puzzle */
+	grid = create_grid(n);
+	if (grid == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory for grid\n");
+		goto out_close;
+	}
+
+	context = create_solver_context(n, fish_size);
+	if (context == NULL) {
+		fprintf(stderr, "Error: Failed to allocate memory for solver\n");
+		free_grid(grid, n);
+		goto out_close;
+	}
+	context->tables.all_different = all_different;
+	if (profile_format != NULL)
+		context->tables.profile = &profile;
 
+	/* Spread the units of each big puzzle over several threads */
+	if (unit_threads > 1 &&
+	    create_unit_pool(context, unit_threads) == NULL) {
+		fprintf(stderr, "Error: Failed to start the unit threads\n");
+		free_solver_context(context);
+		free_grid(grid, n);
+		goto out_close;
+	}
+
+	memset(&summary, 0, sizeof(summary));
+	while (1) {
 		/* Read the Sudoku grid from the file */
 		read_status = read_grid_from_file(grid, file, n);
 
 		if (read_status != 0) {
 			/* If read failed because we reached EOF */
-			if (feof(file)) {
+			if (read_status == 1) {
 				DPRINTF("Reached EOF\n");
 				break;
 			} else {
 				fprintf(stderr, "Error: Failed to read grid from file\n");
+				free_solver_context(context);
 				free_grid(grid, n);
-				fclose(file);
-				return 1;
+				goto out_close;
 			}
 		}
 
@@ -90,28 +253,60 @@ int main(int argc, char **argv)
 
 		/* Solve the sudoku */
 		DPRINTF("Solving the sudoku...\n\n");
-		sudoku_solver(grid, n);
+		sudoku_solver(context, grid);
+		read_grade(context, &grade);
 		DPRINTF("The proposed grid:\n");
 		DPRINT_SUDOKU(grid, n);
 
 		DPRINTF("\n\n--------------------\n\n");
 
+		if (output != NULL)
+			write_grid_to_file(grid, output, n);
+		if (grades != NULL)
+			write_grade_to_file(&grade, grades);
 		if (check_solved(grid, n))
-			++tot_solved;
-
-		/* Free the grid */
-		free_grid(grid, n);
+			++summary.solved;
+		++summary.difficulties[grade.difficulty];
 	}
 
+	free_solver_context(context);
+	free_grid(grid, n);
+
+out_report:
 	/* End timing */
-	end_time = clock();
-	computation_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	computation_time = (double)(end_time.tv_sec - start_time.tv_sec) +
+			   (double)(end_time.tv_nsec - start_time.tv_nsec) / 1e9;
 	printf("\nTotal computation completed in %.6f seconds.\n",
 	       computation_time);
 
-	printf("Sudokus completely solved: %d\n\n", tot_solved);
+	printf("Sudokus completely solved: %d\n", summary.solved);
+
+	/* How hard the puzzles were, from the techniques they needed */
+	for (difficulty = 0; difficulty < N_DIFFICULTIES; ++difficulty)
+		printf("  %-8s %d\n", difficulty_name(difficulty),
+		       summary.difficulties[difficulty]);
+	printf("\n");
+
+	/* Where propagation spent its time */
+	if (profile_format != NULL && strcmp(profile_format, "json") == 0)
+		profile_print_json(&profile, stdout);
+	else if (profile_format != NULL)
+		profile_print_table(&profile, stdout);
 
 	/* Free allocated resources */
+	if (grades != NULL)
+		fclose(grades);
+	if (output != NULL)
+		fclose(output);
 	fclose(file);
 	return 0;
+
+out_close:
+	if (grades != NULL)
+		fclose(grades);
+	if (output != NULL)
+		fclose(output);
+	fclose(file);
+	return 1;
 }
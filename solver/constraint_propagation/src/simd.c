@@ -0,0 +1,390 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/debug.h"
+#include "../include/grade.h"
+#include "../include/simd.h"
+#include "../include/solver.h"
+
+#define N_CELLS (SIMD_SIZE * SIMD_SIZE)
+#define N_UNITS (3 * SIMD_SIZE)
+#define BOX_SIDE 3
+#define ALL_VALUES 0x1ff
+
+/* Techniques of the kernel, the cheapest ones of the scalar schedule */
+#define SIMD_TECHNIQUES (TECHNIQUE_INTERSECTION_REMOVAL + 1)
+
+/*
+ * One 16-bit candidate mask per puzzle. The generic vector type compiles to
+ * SSE2 registers on x86-64, to AVX2 ones with -mavx2, and to plain integer
+ * code on targets without vectors.
+ */
+typedef unsigned short lanes __attribute__((vector_size(2 * SIMD_LANES)));
+
+/**
+ * Candidates of the puzzles in flight, structure of arrays: one vector per
+ * cell, the same lane of every vector belongs to the same puzzle.
+ */
+struct simd_state {
+	lanes candidates[N_CELLS];
+	lanes previous[N_CELLS];	/* Candidates before the last round */
+	lanes eliminated[N_CELLS];	/* Intersection eliminations */
+	lanes uses[SIMD_TECHNIQUES];	/* Rounds each technique made progress */
+	int units[N_UNITS][SIMD_SIZE];	/* Cells of each unit */
+	int cell_units[N_CELLS][3];	/* Row, column and box of each cell */
+	int puzzle[SIMD_LANES];		/* Puzzle in each lane, -1 if none */
+};
+
+/*
+ * Sets every lane of a vector to value. Vectors go through pointers only:
+ * passing them by value would depend on the instruction set enabled.
+ */
+static void broadcast(lanes *vector, unsigned short value)
+{
+	int lane;
+
+	for (lane = 0; lane < SIMD_LANES; ++lane)
+		(*vector)[lane] = value;
+}
+
+/* Same unit numbering as the scalar solver: rows, columns, then boxes */
+static void build_units(struct simd_state *state)
+{
+	int i, j; /* Loop variables */
+	int cell;
+	int box;
+
+	for (i = 0; i < SIMD_SIZE; ++i) {
+		for (j = 0; j < SIMD_SIZE; ++j) {
+			cell = i * SIMD_SIZE + j;
+			box = (i / BOX_SIDE) * BOX_SIDE + j / BOX_SIDE;
+
+			state->units[i][j] = cell;
+			state->units[SIMD_SIZE + j][i] = cell;
+			state->units[2 * SIMD_SIZE + box]
+				    [(i % BOX_SIDE) * BOX_SIDE + j % BOX_SIDE] =
+				cell;
+
+			state->cell_units[cell][0] = i;
+			state->cell_units[cell][1] = SIMD_SIZE + j;
+			state->cell_units[cell][2] = 2 * SIMD_SIZE + box;
+		}
+	}
+}
+
+static void load_lane(struct simd_state *state, int lane, int **grid)
+{
+	int i, j; /* Loop variables */
+	int technique;
+
+	for (technique = 0; technique < SIMD_TECHNIQUES; ++technique)
+		state->uses[technique][lane] = 0;
+
+	for (i = 0; i < SIMD_SIZE; ++i)
+		for (j = 0; j < SIMD_SIZE; ++j)
+			state->candidates[i * SIMD_SIZE + j][lane] =
+				grid[i][j] != 0 ? 1 << (grid[i][j] - 1) :
+						  ALL_VALUES;
+}
+
+/* Writes the cells the lane resolved back into the grid */
+static void store_lane(struct simd_state *state, int lane, int **grid)
+{
+	int i, j; /* Loop variables */
+	int value;
+	unsigned short mask;
+
+	for (i = 0; i < SIMD_SIZE; ++i) {
+		for (j = 0; j < SIMD_SIZE; ++j) {
+			mask = state->candidates[i * SIMD_SIZE + j][lane];
+			if (mask == 0 || (mask & (mask - 1)) != 0)
+				continue;
+
+			for (value = 0; !(mask & (1 << value)); ++value)
+				;
+			grid[i][j] = value + 1;
+		}
+	}
+}
+
+/*
+ * Box-line intersections along one direction. Segments are the three cells
+ * a line shares with a box; segment[line * 3 + k] is the union of the
+ * candidates of the line's k-th segment. Values of a segment found nowhere
+ * else in its box leave the rest of the line (pointing), values found
+ * nowhere else on its line leave the rest of the box (claiming).
+ */
+static void intersections(struct simd_state *state, int line_base,
+			  const lanes *segment)
+{
+	int line, k, other, t; /* Loop variables */
+	int first;
+	lanes box_rest;
+	lanes line_rest;
+	lanes pointing;
+	lanes claiming;
+
+	for (line = 0; line < SIMD_SIZE; ++line) {
+		first = line - line % BOX_SIDE;
+
+		for (k = 0; k < BOX_SIDE; ++k) {
+			box_rest = segment[(first + (line + 1) % BOX_SIDE) *
+					   BOX_SIDE + k] |
+				   segment[(first + (line + 2) % BOX_SIDE) *
+					   BOX_SIDE + k];
+			line_rest = segment[line * BOX_SIDE + (k + 1) % BOX_SIDE] |
+				    segment[line * BOX_SIDE + (k + 2) % BOX_SIDE];
+			pointing = segment[line * BOX_SIDE + k] & ~box_rest;
+			claiming = segment[line * BOX_SIDE + k] & ~line_rest;
+
+			/* The line outside the box */
+			for (t = 0; t < SIMD_SIZE; ++t)
+				if (t / BOX_SIDE != k)
+					state->eliminated[state->units
+						[line_base + line][t]] |=
+						pointing;
+
+			/* The box outside the line */
+			for (other = first; other < first + BOX_SIDE;
+			     ++other) {
+				if (other == line)
+					continue;
+				for (t = k * BOX_SIDE;
+				     t < (k + 1) * BOX_SIDE; ++t)
+					state->eliminated[state->units
+						[line_base + other][t]] |=
+						claiming;
+			}
+		}
+	}
+}
+
+/*
+ * One round of naked singles, hidden singles and intersections. Like the
+ * scalar schedule, a lane only gets hidden singles if naked singles made no
+ * progress on it this round, and intersections if neither did, so the uses
+ * counted grade its puzzle the same way. Sets the lanes of bad that reached
+ * a contradiction.
+ */
+static void propagate_lanes(struct simd_state *state, lanes *bad)
+{
+	int unit, k, cell; /* Loop variables */
+	int *units;
+	lanes *candidates;
+	lanes fixed[N_UNITS];
+	lanes segment[2][N_UNITS];
+	lanes zero, one, all;
+	lanes once, twice;
+	lanes mask, single, hidden, taken;
+	lanes stuck, progress;
+
+	candidates = state->candidates;
+	broadcast(&zero, 0);
+	broadcast(&one, 1);
+	broadcast(&all, ALL_VALUES);
+	*bad = zero;
+
+	/* Naked singles: values fixed in a unit leave its other cells */
+	for (unit = 0; unit < N_UNITS; ++unit) {
+		once = zero;
+		twice = zero;
+		for (k = 0; k < SIMD_SIZE; ++k) {
+			mask = candidates[state->units[unit][k]];
+			mask &= (lanes)((mask & (mask - one)) == zero);
+			twice |= once & mask;
+			once |= mask;
+		}
+		fixed[unit] = once;
+		*bad |= twice;
+	}
+
+	progress = zero;
+	for (cell = 0; cell < N_CELLS; ++cell) {
+		units = state->cell_units[cell];
+		mask = candidates[cell];
+		single = (lanes)((mask & (mask - one)) == zero);
+		candidates[cell] = mask & ~((fixed[units[0]] | fixed[units[1]] |
+					     fixed[units[2]]) & ~single);
+		progress |= mask ^ candidates[cell];
+	}
+	stuck = (lanes)(progress == zero);
+	state->uses[TECHNIQUE_NAKED_SINGLES] += one & ~stuck;
+
+	/* Hidden singles: a value with one place in a unit goes there */
+	progress = zero;
+	for (unit = 0; unit < N_UNITS; ++unit) {
+		once = zero;
+		twice = zero;
+		for (k = 0; k < SIMD_SIZE; ++k) {
+			mask = candidates[state->units[unit][k]];
+			twice |= once & mask;
+			once |= mask;
+		}
+		*bad |= all & ~once;
+		once &= ~twice;
+
+		for (k = 0; k < SIMD_SIZE; ++k) {
+			cell = state->units[unit][k];
+			mask = candidates[cell];
+			hidden = mask & once;
+			taken = (lanes)(hidden != zero) & stuck;
+			*bad |= hidden & (hidden - one);
+			candidates[cell] = (hidden & taken) | (mask & ~taken);
+			progress |= mask ^ candidates[cell];
+		}
+	}
+	state->uses[TECHNIQUE_HIDDEN_SINGLES] += one & stuck &
+						 (lanes)(progress != zero);
+	stuck &= (lanes)(progress == zero);
+
+	/* Intersections, from the segments of rows and of columns */
+	for (unit = 0; unit < 2 * SIMD_SIZE; ++unit)
+		for (k = 0; k < BOX_SIDE; ++k)
+			segment[unit / SIMD_SIZE]
+			       [(unit % SIMD_SIZE) * BOX_SIDE + k] =
+				candidates[state->units[unit][k * BOX_SIDE]] |
+				candidates[state->units[unit][k * BOX_SIDE + 1]] |
+				candidates[state->units[unit][k * BOX_SIDE + 2]];
+
+	for (cell = 0; cell < N_CELLS; ++cell)
+		state->eliminated[cell] = zero;
+	intersections(state, 0, segment[0]);
+	intersections(state, SIMD_SIZE, segment[1]);
+
+	progress = zero;
+	for (cell = 0; cell < N_CELLS; ++cell) {
+		mask = candidates[cell];
+		candidates[cell] = mask & ~(state->eliminated[cell] & stuck);
+		progress |= mask ^ candidates[cell];
+		*bad |= (lanes)(candidates[cell] == zero);
+	}
+	state->uses[TECHNIQUE_INTERSECTION_REMOVAL] += one & stuck &
+						       (lanes)(progress != zero);
+}
+
+/* Grades a retired lane from its uses, plus the scalar trace if any */
+static void grade_lane(const struct simd_state *state, int lane,
+		       const struct solver_context *context, int scalar,
+		       struct puzzle_grade *grade)
+{
+	int technique;
+
+	if (scalar)
+		read_grade(context, grade);
+	else
+		memset(grade, 0, sizeof(*grade));
+
+	for (technique = 0; technique < SIMD_TECHNIQUES; ++technique)
+		grade->uses[technique] += state->uses[technique][lane];
+	finish_grade(grade);
+}
+
+int simd_solve(int ***grids, int count, struct solver_context *context,
+	       struct puzzle_grade *grades)
+{
+	struct simd_state state;
+	lanes zero, one;
+	lanes bad, changed, open;
+	lanes mask;
+	int **grid;
+	int lane, cell; /* Loop variables */
+	int next;
+	int active;
+	int status;
+	int scalar;
+	int solved;
+	unsigned char blank[N_CELLS]; /* Empty cells of a stalled puzzle */
+
+	build_units(&state);
+	broadcast(&zero, 0);
+	broadcast(&one, 1);
+
+	/* Empty lanes hold a blank grid, which never changes */
+	for (cell = 0; cell < N_CELLS; ++cell)
+		broadcast(&state.candidates[cell], ALL_VALUES);
+	for (cell = 0; cell < SIMD_TECHNIQUES; ++cell)
+		state.uses[cell] = zero;
+
+	next = 0;
+	active = 0;
+	for (lane = 0; lane < SIMD_LANES; ++lane) {
+		state.puzzle[lane] = -1;
+		if (next < count) {
+			load_lane(&state, lane, grids[next]);
+			state.puzzle[lane] = next++;
+			++active;
+		}
+	}
+
+	status = 0;
+	while (active > 0) {
+		memcpy(state.previous, state.candidates,
+		       sizeof(state.candidates));
+		propagate_lanes(&state, &bad);
+
+		changed = zero;
+		open = zero;
+		for (cell = 0; cell < N_CELLS; ++cell) {
+			mask = state.candidates[cell];
+			changed |= mask ^ state.previous[cell];
+			open |= mask & (mask - one);
+		}
+
+		for (lane = 0; lane < SIMD_LANES; ++lane) {
+			if (state.puzzle[lane] < 0 ||
+			    (!bad[lane] && changed[lane]))
+				continue;
+
+			/*
+			 * A contradiction leaves the puzzle as given, like the
+			 * scalar solver does. Otherwise the lane is at a
+			 * fixpoint: solved, or to be finished by a search.
+			 */
+			grid = grids[state.puzzle[lane]];
+			scalar = 0;
+			if (!bad[lane]) {
+				for (cell = 0; cell < N_CELLS && open[lane]; ++cell)
+					blank[cell] = grid[cell / SIMD_SIZE]
+							  [cell % SIMD_SIZE] == 0;
+				store_lane(&state, lane, grid);
+				if (open[lane]) {
+					DPRINTF("Lane %d stalled, solving puzzle %d in scalar\n",
+						lane, state.puzzle[lane]);
+					solved = sudoku_solver(context, grid);
+					if (solved < 0)
+						status = -1;
+
+					/*
+					 * The search found no solution, take
+					 * back what the kernel filled in
+					 */
+					for (cell = 0; cell < N_CELLS && solved != 1;
+					     ++cell)
+						if (blank[cell])
+							grid[cell / SIMD_SIZE]
+							    [cell % SIMD_SIZE] = 0;
+					scalar = 1;
+				}
+			}
+			if (grades != NULL)
+				grade_lane(&state, lane, context, scalar,
+					   &grades[state.puzzle[lane]]);
+
+			/* Hand the lane the next puzzle */
+			if (next < count) {
+				load_lane(&state, lane, grids[next]);
+				state.puzzle[lane] = next++;
+			} else {
+				for (cell = 0; cell < N_CELLS; ++cell)
+					state.candidates[cell][lane] =
+						ALL_VALUES;
+				state.puzzle[lane] = -1;
+				--active;
+			}
+		}
+	}
+
+	return status;
+}
@@ -1,119 +1,262 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../include/debug.h"
-#include "../include/linked_list.h"
+#include "../include/profile.h"
 #include "../include/solver.h"
 #include "../include/sudoku_utils.h"
+#include "../include/unit_pool.h"
+
+static const char *technique_names[N_TECHNIQUES] = {
+	"naked_singles",
+	"hidden_singles",
+	"intersection_removal",
+	"all_different",
+	"naked_candidates",
+	"hidden_candidates",
+	"fish",
+};
+
+/*
+ * Bitsets are words words long. Puzzles up to 64x64 take a single word, so
+ * every helper is a small test for it, which the compiler inlines, in
+ * front of a loop over the words for the bigger puzzles.
+ */
+
+static int count_words(const unsigned long *mask, int words)
+{
+	int w;
+	int count;
+
+	count = 0;
+	for (w = 0; w < words; ++w)
+		count += __builtin_popcountl(mask[w]);
+	return count;
+}
 
-int sudoku_solver(int **grid, int n)
+/* Number of set bits of a bitset */
+static int count_bits(const unsigned long *mask, int words)
 {
-	int i, j; /* Loop variables */
-	int is_changed; /* Flag to check if any changes are made */
-	int depth;
-	int max_depth;
-	int numbers_left;
-	struct node ***extended_grid; /* Extended grid for constraint propagation */
-
-	int ***already_propagated_rows;
-	int ***already_propagated_columns;
-	int ***already_propagated_boxes;
-	int **selected_propagated;
-
-	/* TODO: Add checks for errors */
-	max_depth = (int)floor((double)n / 2);
-	DPRINTF("Max depth: %d\n\n", max_depth);
-	already_propagated_rows = (int ***)malloc(max_depth * sizeof(int **));
-	for (i = 0; i < max_depth; ++i) {
-		already_propagated_rows[i] = (int **)malloc(n * sizeof(int *));
-		for (j = 0; j < n; ++j)
-			already_propagated_rows[i][j] = (int *)malloc(n * sizeof(int));
-		
-		initialize_propagation_matrix(already_propagated_rows[i], n);
-	}
-
-	already_propagated_columns = (int ***)malloc(max_depth * sizeof(int **));
-	for (i = 0; i < max_depth; ++i) {
-		already_propagated_columns[i] = (int **)malloc(n * sizeof(int *));
-		for (j = 0; j < n; ++j)
-			already_propagated_columns[i][j] = (int *)malloc(n * sizeof(int));
-		
-		initialize_propagation_matrix(already_propagated_columns[i], n);
-	}
-
-	already_propagated_boxes = (int ***)malloc(max_depth * sizeof(int **));
-	for (i = 0; i < max_depth; ++i) {
-		already_propagated_boxes[i] = (int **)malloc(n * sizeof(int *));
-		for (j = 0; j < n; ++j)
-			already_propagated_boxes[i][j] = (int *)malloc(n * sizeof(int));
-		
-		initialize_propagation_matrix(already_propagated_boxes[i], n);
-	}
-
-	/* Create an extended grid */
-	extended_grid = extend_grid(grid, n);
-	if (extended_grid == NULL) {
-		fprintf(stderr, "Error: Unable to create extended grid\n");
+	if (words == 1)
+		return __builtin_popcountl(mask[0]);
+	return count_words(mask, words);
+}
+
+static int is_empty_words(const unsigned long *mask, int words)
+{
+	int w;
+
+	for (w = 0; w < words; ++w)
+		if (mask[w] != 0)
+			return 0;
+	return 1;
+}
+
+static int is_empty(const unsigned long *mask, int words)
+{
+	if (words == 1)
+		return mask[0] == 0;
+	return is_empty_words(mask, words);
+}
+
+static int is_single_words(const unsigned long *mask, int words)
+{
+	int w;
+	int found;
+
+	found = 0;
+	for (w = 0; w < words; ++w) {
+		if (mask[w] == 0)
+			continue;
+		if (found || (mask[w] & (mask[w] - 1)) != 0)
+			return 0;
+		found = 1;
+	}
+	return found;
+}
+
+/* Whether exactly one bit is set, cheaper than counting them */
+static int is_single(const unsigned long *mask, int words)
+{
+	if (words == 1)
+		return mask[0] != 0 && (mask[0] & (mask[0] - 1)) == 0;
+	return is_single_words(mask, words);
+}
+
+/* Whether more than one bit is set */
+static int is_several(const unsigned long *mask, int words)
+{
+	if (words == 1)
+		return (mask[0] & (mask[0] - 1)) != 0;
+	return count_words(mask, words) > 1;
+}
+
+static int is_subset_words(const unsigned long *mask, const unsigned long *of,
+			   int words)
+{
+	int w;
+
+	for (w = 0; w < words; ++w)
+		if (mask[w] & ~of[w])
+			return 0;
+	return 1;
+}
+
+/* Whether every bit of mask is also set in of */
+static int is_subset(const unsigned long *mask, const unsigned long *of,
+		     int words)
+{
+	if (words == 1)
+		return (mask[0] & ~of[0]) == 0;
+	return is_subset_words(mask, of, words);
+}
+
+static int next_bit_words(const unsigned long *mask, int words, int bit)
+{
+	int w;
+	unsigned long rest;
+
+	w = bit / BITS_PER_WORD;
+	if (w >= words)
 		return -1;
+
+	rest = mask[w] & (~0UL << (bit % BITS_PER_WORD));
+	while (rest == 0) {
+		if (++w == words)
+			return -1;
+		rest = mask[w];
 	}
 
-	/* Print the extended grid */
-	DPRINTF("\nExtended grid:\n");
-	DPRINT_EXTENDED_GRID(extended_grid, n);	
+	return w * BITS_PER_WORD + __builtin_ctzl(rest);
+}
 
-	/* Solve the Sudoku puzzle using constraint propagation */
-	do {
-		is_changed = 0; /* Reset the flag for each iteration */
-
-		/* Use the technique of naked candidates */
-		for (depth = 1; depth <= max_depth; ++depth) {
-			selected_propagated = already_propagated_rows[depth - 1];
-			is_changed += naked_candidates_rows(extended_grid,
-				n, selected_propagated, depth);
-			
-			DPRINTF("\n\nPropagation at depth (row): %d\n", depth);
-			DPRINT_EXTENDED_GRID(extended_grid, n);
-			DPRINTF("\n\n\n");
-
-			selected_propagated = already_propagated_columns[depth - 1];
-			is_changed += naked_candidates_columns(extended_grid,
-				n, selected_propagated, depth);
-		
-			DPRINTF("\n\nPropagation at depth (col): %d\n", depth);
-			DPRINT_EXTENDED_GRID(extended_grid, n);
-			DPRINTF("\n\n\n");
-			
-			selected_propagated = already_propagated_boxes[depth - 1];
-			is_changed += naked_candidates_boxes(extended_grid,
-				n, selected_propagated, depth);
-			
-			DPRINTF("\n\nPropagation at depth (box): %d\n", depth);
-			DPRINT_EXTENDED_GRID(extended_grid, n);
-			DPRINTF("\n\n\n");
-		}
+/* Index of the first set bit from bit on, -1 if there is none */
+static int next_bit(const unsigned long *mask, int words, int bit)
+{
+	unsigned long rest;
 
-		/* Use technique of hidden singles */
-		DPRINTF("\n\nHidden singles...\n");
-		is_changed += hidden_singles(extended_grid, n);
+	if (words == 1) {
+		if (bit >= BITS_PER_WORD)
+			return -1;
+		rest = mask[0] & (~0UL << bit);
+		return rest != 0 ? __builtin_ctzl(rest) : -1;
+	}
+	return next_bit_words(mask, words, bit);
+}
 
-		/* Print the updated extended grid */
-		DPRINTF("\nUpdated extended grid:\n");
-		DPRINT_EXTENDED_GRID(extended_grid, n);
-		DPRINTF("\n\n\n");
-	} while (is_changed);
+static int test_bit(const unsigned long *mask, int bit)
+{
+	return (mask[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+static void set_bit(unsigned long *mask, int bit)
+{
+	mask[bit / BITS_PER_WORD] |= 1UL << (bit % BITS_PER_WORD);
+}
+
+static void clear_bit(unsigned long *mask, int bit)
+{
+	mask[bit / BITS_PER_WORD] &= ~(1UL << (bit % BITS_PER_WORD));
+}
+
+static int keep_value(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n, int cell, int value);
+static int hidden_singles_unit(unsigned long *extended_grid,
+			       struct unit_tables *tables, int n, int unit);
+
+/* dst = a | b */
+static void merge_bits(unsigned long *dst, const unsigned long *a,
+		       const unsigned long *b, int words)
+{
+	int w;
+
+	if (words == 1) {
+		dst[0] = a[0] | b[0];
+		return;
+	}
+
+	for (w = 0; w < words; ++w)
+		dst[w] = a[w] | b[w];
+}
+
+/* Clock and running totals taken before a pass of a technique */
+struct profile_sample {
+	double start;
+	unsigned long eliminated;
+	unsigned long resolved;
+};
+
+static void sample_begin(struct unit_tables *tables,
+			 struct profile_sample *sample)
+{
+	if (tables->profile == NULL)
+		return;
+
+	sample->start = profile_clock();
+	sample->eliminated = tables->eliminated;
+	sample->resolved = tables->resolved;
+}
+
+static void sample_end(struct unit_tables *tables,
+		       const struct profile_sample *sample, int depth,
+		       int technique)
+{
+	struct technique_stats *stats;
+
+	if (tables->profile == NULL)
+		return;
+
+	if (depth >= PROFILE_DEPTHS)
+		depth = PROFILE_DEPTHS - 1;
+	stats = &tables->profile->stats[depth][technique];
+	++stats->calls;
+	stats->time += profile_clock() - sample->start;
+	stats->eliminations += tables->eliminated - sample->eliminated;
+	stats->resolved += tables->resolved - sample->resolved;
+}
+
+/* Counters of the subsets of that kind and size, or NULL */
+static struct tuple_stats *tuple_sample(struct unit_tables *tables,
+					int kind, int size)
+{
+	if (tables->profile == NULL || size < 2)
+		return NULL;
+
+	return &tables->profile->tuples[kind][size];
+}
+
+int sudoku_solver(struct solver_context *context, int **grid)
+{
+	int i, j; /* Loop variables */
+	int n;
+	int solved;
+	int numbers_left;
+	int words;
+	unsigned long *mask;
+	unsigned long *extended_grid; /* Extended grid for constraint propagation */
+
+	/* Fill the extended grid and the unit tables for this puzzle */
+	extend_grid(context, grid);
+	n = context->n;
+	words = context->tables.words;
+	extended_grid = context->extended_grid;
+
+	/* Print the extended grid */
+	DPRINTF("\nExtended grid:\n");
+	DPRINT_EXTENDED_GRID(extended_grid, n);
+
+	/* Solve the Sudoku puzzle, branching where propagation stalls */
+	solved = search_solution(extended_grid, &context->tables, n,
+				 context->fish_size, 0);
+	if (solved < 0)
+		return -1;
 
 	/* Count numbers left for progress */
 	numbers_left = 0;
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			struct node *temp = extended_grid[i][j];
-			while (temp != NULL) {
-				numbers_left++;
-				temp = temp->next;
-			}
-		}
-	}
+	for (i = 0; i < n * n; i++)
+		numbers_left += count_bits(extended_grid + i * words, words);
 	DPRINTF("Numbers left in the extended grid: %d\n", numbers_left);
 	DPRINTF("Progress: %2.1f%%\n",
 	       (double)((double)1 - (double)(numbers_left - n * n) /
@@ -121,834 +264,1367 @@ int sudoku_solver(int **grid, int n)
 		       100);
 
 	/* Fill the original grid with single values */
-	for (i = 0; i < n; i++) {
+	for (i = 0; i < n && solved; i++) {
 		for (j = 0; j < n; j++) {
-			struct node *temp = extended_grid[i][j];
+			mask = extended_grid + (i * n + j) * words;
 
-			if (temp->next == NULL)
-				grid[i][j] = temp->data;
+			if (is_single(mask, words))
+				grid[i][j] = next_bit(mask, words, 0) + 1;
 		}
 	}
 
-	/* Free the extended grid */
-	free_extended_grid(extended_grid, n);
-	free_propagation_matrix(already_propagated_rows, n);
-	free_propagation_matrix(already_propagated_columns, n);
-	free_propagation_matrix(already_propagated_boxes, n);
+	return solved;
+}
+
+int technique_items(int technique, int n)
+{
+	switch (technique) {
+	case TECHNIQUE_HIDDEN_SINGLES:
+	case TECHNIQUE_ALL_DIFFERENT:
+	case TECHNIQUE_NAKED_CANDIDATES:
+	case TECHNIQUE_HIDDEN_CANDIDATES:
+		return 3 * n;
+	case TECHNIQUE_INTERSECTION_REMOVAL:
+	case TECHNIQUE_FISH:
+		return n;
+	}
 
 	return 0;
 }
 
-struct node ***extend_grid(int **grid, int n)
+int run_technique_items(unsigned long *extended_grid,
+			struct unit_tables *tables, int n, int fish_size,
+			int technique, int first, int step)
 {
-	struct node ***extended_grid; /* Extended grid */
-	int i, j, k; /* Loop variables */
-
-	extended_grid = (struct node ***)malloc(n * sizeof(struct node **));
-	if (extended_grid == NULL) {
-		fprintf(stderr,
-			"Error: Unable to allocate memory for extended grid\n");
-		return NULL;
+	int i; /* Loop variable */
+	int changed;
+	int items;
+
+	changed = 0;
+	items = technique_items(technique, n);
+	for (i = first; i < items && !tables->contradiction; i += step) {
+		switch (technique) {
+		case TECHNIQUE_HIDDEN_SINGLES:
+			changed += hidden_singles_unit(extended_grid, tables, n,
+						       i);
+			break;
+		case TECHNIQUE_INTERSECTION_REMOVAL:
+			changed += intersection_removal(extended_grid, tables, n,
+							i);
+			break;
+		case TECHNIQUE_ALL_DIFFERENT:
+			if (tables->all_different)
+				changed += all_different(extended_grid, tables,
+							 n, i);
+			break;
+		case TECHNIQUE_NAKED_CANDIDATES:
+			changed += naked_candidates(extended_grid, tables, n, i);
+			break;
+		case TECHNIQUE_HIDDEN_CANDIDATES:
+			changed += hidden_candidates(extended_grid, tables, n, i);
+			break;
+		case TECHNIQUE_FISH:
+			if (fish_size >= 2)
+				changed += fish(extended_grid, tables, n, i,
+						fish_size);
+			break;
+		}
 	}
 
-	for (i = 0; i < n; i++) {
-		extended_grid[i] =
-			(struct node **)malloc(n * sizeof(struct node *));
-		if (extended_grid[i] == NULL) {
-			fprintf(stderr,
-				"Error: Unable to allocate memory for extended grid row\n");
-			for (j = 0; j < i; j++) {
-				free(extended_grid[j]);
-			}
-			free(extended_grid);
-			return NULL;
+	return changed;
+}
+
+/*
+ * One pass of a technique over the whole grid, split between the threads
+ * of the unit pool if there is one.
+ */
+static int run_technique(unsigned long *extended_grid,
+			 struct unit_tables *tables, int n, int fish_size,
+			 int technique)
+{
+	if (technique == TECHNIQUE_NAKED_SINGLES)
+		return naked_singles(extended_grid, tables, n);
+
+	if (tables->pool != NULL)
+		return unit_pool_run(tables->pool, extended_grid, tables, n,
+				     fish_size, technique);
+
+	return run_technique_items(extended_grid, tables, n, fish_size,
+				   technique, 0, 1);
+}
+
+int propagate(unsigned long *extended_grid, struct unit_tables *tables, int n,
+	      int fish_size, int depth)
+{
+	int technique;
+	int changed;
+	struct profile_sample sample = { 0.0, 0, 0 };
+
+	/*
+	 * The techniques are numbered from the cheapest to the most
+	 * expensive. Each one only runs once all the cheaper ones are stuck,
+	 * and any progress goes back to the cheapest, so the expensive
+	 * searches only see grids the simple rules can't improve. The
+	 * search still branches correctly on a grid they skipped, it just
+	 * may have to branch more.
+	 */
+	technique = 0;
+	while (technique < N_TECHNIQUES) {
+		/* Sit out the passes earned by the last fruitless ones */
+		if (tables->skips[technique] > 0) {
+			--tables->skips[technique];
+			++technique;
+			continue;
 		}
 
-		for (j = 0; j < n; j++) {
-			extended_grid[i][j] = NULL;
-			if (grid[i][j] != 0)
-				extended_grid[i][j] =
-					append(extended_grid[i][j], grid[i][j]);
-			else
-				for (k = 1; k <= n; k++)
-					extended_grid[i][j] =
-						append(extended_grid[i][j], k);
-
-			if (extended_grid[i][j] == NULL) {
-				fprintf(stderr,
-					"Error: Unable to create or append node in extended grid\n");
-				free_extended_grid(extended_grid, n);
-
-				return NULL;
-			}
+		/* A technique turned off isn't a fruitless pass, just none */
+		if ((technique == TECHNIQUE_ALL_DIFFERENT &&
+		     !tables->all_different) ||
+		    (technique == TECHNIQUE_FISH && fish_size < 2)) {
+			++technique;
+			continue;
+		}
 
-			/* Debugging output */
-			DPRINTF("Extended grid at [%d][%d]: ", i + 1, j + 1);
-			DPRINT_LIST(extended_grid[i][j]);
-			DPRINTF("\n");
+		sample_begin(tables, &sample);
+		changed = run_technique(extended_grid, tables, n, fish_size,
+					technique);
+		sample_end(tables, &sample, depth, technique);
+
+		/* Stop as soon as the grid can't be completed anymore */
+		if (tables->contradiction)
+			return 0;
+
+		if (changed) {
+			++tables->uses[technique];
+			tables->misses[technique] = 0;
+			technique = 0;
+			continue;
 		}
+
+		/* Each fruitless pass in a row doubles the passes skipped */
+		if (technique >= TECHNIQUE_ALL_DIFFERENT) {
+			++tables->misses[technique];
+			tables->skips[technique] =
+				tables->misses[technique] < 6 ?
+				(1 << tables->misses[technique]) - 1 :
+				MAX_SKIPS;
+		}
+		++technique;
 	}
 
-	return extended_grid;
+	/* Print the updated extended grid */
+	DPRINTF("\nUpdated extended grid:\n");
+	DPRINT_EXTENDED_GRID(extended_grid, n);
+	DPRINTF("\n\n\n");
+
+	/* The givens themselves may conflict */
+	return !has_contradiction(extended_grid, tables, n);
 }
 
-void initialize_propagation_matrix(int **matrix, int n)
+int has_contradiction(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n)
 {
-	int i, j;
+	int i; /* Loop variable */
+	int words;
 
-	for (i = 0; i < n; ++i)
-		for (j = 0; j < n; ++j)
-			matrix[i][j] = 0;
+	words = tables->words;
+
+	/* A cell without candidates */
+	for (i = 0; i < n * n; ++i)
+		if (is_empty(extended_grid + i * words, words))
+			return 1;
+
+	/* A value without places in a unit */
+	for (i = 0; i < 3 * n * n; ++i)
+		if (is_empty(tables->positions + i * words, words))
+			return 1;
+
+	return 0;
 }
 
-int naked_candidates_rows(struct node ***extended_grid, int n,
-			  int **already_propagated, int depth)
+int search_solution(unsigned long *extended_grid, struct unit_tables *tables,
+		    int n, int fish_size, int depth)
 {
-	int i, j; /* Loop variables to go through the matrix */
-	int k; /* Temp loop variable to continue to search for matches */
-	int l; /* Loop variable to save the coordinates */
-	int remaining_nodes;
-	int changed;
-	int n_difference;
-	struct node *candidates;
-	struct node *temp;
-	struct node *temp2;
-	struct coordinates *coord;
+	int i; /* Loop variable */
+	int cell;
+	int fewest;
+	int found;
+	int mark;
+	int count;
+	int value;
+	int words;
+	unsigned long *mask;
 
-	DPRINTF("\nElimination of naked candidates (row) at depth %d\n", depth);
+	if (!propagate(extended_grid, tables, n, fish_size, depth)) {
+		DPRINTF("Contradiction at depth %d, backtracking\n", depth);
+		return 0;
+	}
 
-	/* Set coordinates array to lenght depth */
-	coord = (struct coordinates *)malloc(depth *
-					     sizeof(struct coordinates));
-	if (coord == NULL) {
-		fprintf(stderr, "Memory allocation failed\n");
-		return -1; /* Indicate error */
+	/* Branch on the unresolved cell with the fewest candidates */
+	words = tables->words;
+	cell = -1;
+	fewest = n + 1;
+	for (i = 0; i < n * n && fewest > 2; ++i) {
+		count = count_bits(extended_grid + i * words, words);
+		if (count > 1 && count < fewest) {
+			cell = i;
+			fewest = count;
+		}
 	}
 
-	changed = 0; /* Set changed to 0, since nothing changed yet */
+	/* Every cell has a single value: solved */
+	if (cell < 0)
+		return 1;
+	++tables->branches;
 
-	/* Explore extended grid row-wise */
-	for (i = 0; i < n; ++i) {
-		for (j = 0; j < n; ++j) {
-			remaining_nodes = depth;
-			candidates = NULL; /* Reset candidates list for each potential starting node */
-			l = 0; /* Reset coordinate index for each potential starting node 'i' */
+	/* Everything after this mark is undone after a failed guess */
+	mark = tables->trail_size;
 
-			temp = extended_grid[i][j];
-			DPRINTF("\tAt cell [%d][%d]: ", i + 1, j + 1);
-			DPRINT_LIST(temp);
-			DPRINTF("\n");
+	/* A failed guess is undone, so the cell has all its candidates back */
+	found = 0;
+	mask = extended_grid + cell * words;
+	for (value = next_bit(mask, words, 0); value >= 0 && !found;
+	     value = next_bit(mask, words, value + 1)) {
+		DPRINTF("Depth %d: trying %d at [%d][%d]\n", depth, value + 1,
+			cell / n + 1, cell % n + 1);
 
-			if (temp == NULL) {
-				DPRINTF("\t\t - No values in this cell\n");
-				continue;
-			}
+		keep_value(extended_grid, tables, n, cell, value);
+		found = search_solution(extended_grid, tables, n, fish_size,
+					depth + 1);
 
-			/* Check the right depth */
-			if (size_list(temp) > depth) {
-				DPRINTF("\t\t - More than %d values in this cell\n",
-				       depth);
-				continue;
-			}
+		if (!found)
+			undo_eliminations(extended_grid, tables, n, mark);
+	}
 
-			/* Exclude naked singles for superior tuples */
-			if (size_list(temp) == 1 && depth > 1)
-				continue;
+	return found;
+}
 
-			/* If we are in this section of the code it means we found something with a good depth */
-			DPRINTF("\t\tRight number of values\n");
-
-			/* Check if already propagated */
-			if (!already_propagated[i][j]) {
-				/* Append values in candidate list */
-				temp2 = temp;
-				do {
-					candidates = append(candidates, temp2->data);
-					if (candidates == NULL && temp2->data != 0) {
-						fprintf(stderr, "Failed to append node in elimination\n");
-						free(coord);
-						return -1;
-					}
-					temp2 = temp2->next;
-				} while (temp2 != NULL);
-
-				/* Save node coordinates */
-				coord[l].row = i;
-				coord[l].column = j;
-				l++;
-
-				/* Subtract from counter to signal the possible candidate */
-				DPRINTF("Remaining nodes: %d", remaining_nodes);
-				--remaining_nodes;
-				DPRINTF("...%d\n", remaining_nodes);
-
-				/* If needed for the tuple, search for other candidates on the row */
-				for (k = j + 1; k < n && remaining_nodes != 0; ++k) {
-					/* Exclude adding singles to the tuple */
-					if (size_list(extended_grid[i][k]) <= 1)
-						continue;
-	
-					temp = extended_grid[i][k];
-					n_difference = count_different_values(candidates, extended_grid[i][k]);
-	
-					DPRINTF("\t\t\tCell [%d][%d] - Difference: %d\n", i + 1, k + 1, n_difference);
-	
-					if ((size_list(candidates) + n_difference) <= depth) {
-						/* Add new values to candidates */
-						DPRINTF("\t\t\tAdding new candidates to list...");
-						candidates = add_new_candidates(candidates, extended_grid[i][k]);
-						DPRINT_LIST(candidates);
-						DPRINTF("\n\n");
-	
-						coord[l].row = i;
-						coord[l].column = k;
-						l++;
-	
-						--remaining_nodes;
-						if (remaining_nodes == 0)
-							break;
-					}
-				}
-
-				if (remaining_nodes == 0) {
-					/* Found a complete naked tuple of size 'depth' */
-					DPRINTF("\nFound naked tuple of size %d at cells: ", depth);
-					for (l = 0; l < depth; ++l) {
-						DPRINTF("[%d][%d] ", coord[l].row + 1, coord[l].column + 1);
-					}
-					DPRINTF("\nValues to propagate: ");
-					DPRINT_LIST(candidates);
-					DPRINTF("\n");
-	
-					/* Propagate each value in the candidates list */
-					temp2 = candidates;
-					while (temp2 != NULL) {
-						propagate_row(
-							extended_grid, n, coord, depth,
-							temp2->data); /* Pass 'depth' as n_coordinates */
-						temp2 = temp2->next;
-					}
-	
-					/* Mark involved cells as propagated */
-					for (l = 0; l < depth; ++l) {
-						already_propagated[coord[l].row][coord[l].column] = 1;
-					}
-					changed = 1; /* Signal that at least a change occurred */
-	
-					DPRINTF("\nPropagation complete.\n\n");
-				} else {
-					/* If we didn't find enough matching nodes, this wasn't a valid tuple. */
-					DPRINTF("\t\tDid not find enough matching cells for a tuple starting at [%d][%d]\n\n",
-					       i + 1, j + 1);
-				}
-
-				/* Free the candidates list for the next iteration */
-				free_list(candidates);
-			} else {
-				DPRINTF("\t - Cell [%d][%d] already propagated\n",
-				       i + 1, j + 1);
-				free_list(candidates); /* Free candidates if we skip due to already propagated */
-			}
+struct solver_context *create_solver_context(int n, int fish_size)
+{
+	struct solver_context *context;
+	struct unit_tables *tables;
+	size_t n_masks, n_ints;
+	unsigned long *masks;
+	int i, j; /* Loop variables */
+	int sqrt_n;
+	int words;
+	int cell;
+	int kind;
+
+	context = (struct solver_context *)malloc(sizeof(struct solver_context));
+	if (context == NULL)
+		return NULL;
+
+	/*
+	 * One buffer for every array, bitsets first to keep them aligned:
+	 * the cells, the positions, the intersections, the subset unions
+	 * and the members of a subset.
+	 */
+	sqrt_n = (int)sqrt(n);
+	words = BITSET_WORDS(n);
+	n_masks = (size_t)(4 * n * n + 3 * sqrt_n + n + 2) * words;
+	n_ints = 13 * n * n + 8 * n + (size_t)n * n * n;
+	context->buffer = malloc(n_masks * sizeof(unsigned long) +
+				 n_ints * sizeof(int));
+	if (context->buffer == NULL) {
+		free(context);
+		return NULL;
+	}
+	memset(context->buffer, 0, n_masks * sizeof(unsigned long));
+
+	context->n = n;
+	context->fish_size = fish_size;
+
+	tables = &context->tables;
+	tables->words = words;
+	masks = (unsigned long *)context->buffer;
+	context->extended_grid = masks;
+	tables->positions = context->extended_grid + n * n * words;
+	tables->segments = tables->positions + 3 * n * n * words;
+	tables->box_rows = tables->segments + sqrt_n * words;
+	tables->box_columns = tables->box_rows + sqrt_n * words;
+	tables->unions = tables->box_columns + sqrt_n * words;
+	tables->members = tables->unions + (n + 1) * words;
+	tables->cells = (int *)(masks + n_masks);
+	tables->units = tables->cells + 3 * n * n;
+	tables->slots = tables->units + 3 * n * n;
+	tables->matching = tables->slots + 3 * n * n;
+	tables->scratch = tables->matching + 3 * n * n;
+	tables->stack = tables->scratch + n;
+	tables->graph = tables->stack + n;
+	tables->singles = tables->graph + 6 * n;
+	tables->trail = tables->singles + n * n;
+	tables->trail_size = 0;
+	tables->eliminated = 0;
+	tables->resolved = 0;
+	tables->profile = NULL;
+	tables->deferred = NULL;
+	tables->deferred_size = 0;
+	tables->deferred_capacity = 0;
+	tables->pool = NULL;
+	tables->all_different = 0;
+	tables->singles_size = 0;
+	tables->contradiction = 0;
+	tables->sqrt_n = sqrt_n;
+
+	for (i = 0; i < 3 * n * n; ++i)
+		tables->matching[i] = -1;
+
+	/* Where lines and boxes intersect, as slot bitsets */
+	for (i = 0; i < sqrt_n; ++i) {
+		for (j = 0; j < sqrt_n; ++j) {
+			set_bit(tables->segments + i * words, i * sqrt_n + j);
+			set_bit(tables->box_rows + i * words, i * sqrt_n + j);
+			set_bit(tables->box_columns + i * words,
+				j * sqrt_n + i);
 		}
 	}
 
-	free(coord);
-	DPRINTF("\n");
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			cell = i * n + j;
+
+			/* Row, column and box containing the cell */
+			tables->units[cell * 3] = i;
+			tables->slots[cell * 3] = j;
+			tables->units[cell * 3 + 1] = n + j;
+			tables->slots[cell * 3 + 1] = i;
+			tables->units[cell * 3 + 2] = 2 * n +
+				(i / sqrt_n) * sqrt_n + j / sqrt_n;
+			tables->slots[cell * 3 + 2] =
+				(i % sqrt_n) * sqrt_n + j % sqrt_n;
+
+			for (kind = 0; kind < 3; ++kind)
+				tables->cells[tables->units[cell * 3 + kind] * n +
+					      tables->slots[cell * 3 + kind]] =
+					cell;
+		}
+	}
 
-	return changed;
+	return context;
 }
 
-int naked_candidates_columns(struct node ***extended_grid, int n,
-	int **already_propagated, int depth)
+void free_solver_context(struct solver_context *context)
 {
-	int i, j; /* Loop variables to go through the matrix */
-	int k; /* Temp loop variable to continue to search for matches */
-	int l; /* Loop variable to save the coordinates */
-	int remaining_nodes;
-	int changed;
-	int n_difference;
-	struct node *candidates;
-	struct node *temp;
-	struct node *temp2;
-	struct coordinates *coord;
-
-	DPRINTF("\nElimination of naked candidates (column) at depth %d\n", depth);
-
-	/* Set coordinates array to lenght depth */
-	coord = (struct coordinates *)malloc(depth *
-					     sizeof(struct coordinates));
-	if (coord == NULL) {
-		fprintf(stderr, "Memory allocation failed\n");
-		return -1; /* Indicate error */
-	}
-
-	changed = 0; /* Set changed to 0, since nothing changed yet */
-
-	/* Explore extended grid column-wise */
-	for (j = 0; j < n; ++j) {
-		for (i = 0; i < n; ++i) {
-			remaining_nodes = depth;
-			candidates = NULL; /* Reset candidates list for each potential starting node */
-			l = 0; /* Reset coordinate index for each potential starting node 'i' */
-
-			temp = extended_grid[i][j];
-			DPRINTF("\tAt cell [%d][%d]: ", i + 1, j + 1);
-			DPRINT_LIST(temp);
-			DPRINTF("\n");
-
-			if (temp == NULL) {
-				DPRINTF("\t\t - No values in this cell\n");
-				continue;
-			}
+	if (context == NULL)
+		return;
 
-			/* Check the right depth */
-			if (size_list(temp) > depth) {
-				DPRINTF("\t\t - More than %d values in this cell\n",
-				       depth);
-				continue;
-			}
+	free_unit_pool(context->tables.pool);
+	free(context->buffer);
+	free(context);
+}
 
-			/* Exclude naked singles for superior tuples */
-			if (size_list(temp) == 1 && depth > 1)
-				continue;
+void extend_grid(struct solver_context *context, int **grid)
+{
+	struct unit_tables *tables;
+	unsigned long *extended_grid; /* Extended grid */
+	unsigned long *mask;
+	int i, j; /* Loop variables */
+	int n;
+	int cell;
+	int kind;
+	int value;
+	int words;
+
+	n = context->n;
+	tables = &context->tables;
+	words = tables->words;
+	extended_grid = context->extended_grid;
+
+	/* Forget the previous puzzle */
+	memset(extended_grid, 0, n * n * words * sizeof(unsigned long));
+	memset(tables->positions, 0,
+	       3 * n * n * words * sizeof(unsigned long));
+	tables->trail_size = 0;
+	tables->singles_size = 0;
+	tables->contradiction = 0;
+	memset(tables->misses, 0, sizeof(tables->misses));
+	memset(tables->skips, 0, sizeof(tables->skips));
+	memset(tables->uses, 0, sizeof(tables->uses));
+	tables->branches = 0;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			cell = i * n + j;
+			mask = extended_grid + cell * words;
 
-			/* If we are in this section of the code it means we found something with a good depth */
-			DPRINTF("\t\tRight number of values\n");
-
-			/* Check if already propagated */
-			if (!already_propagated[i][j]) {
-				/* Append values in candidate list */
-				temp2 = temp;
-				do {
-					candidates = append(candidates, temp2->data);
-					if (candidates == NULL && temp2->data != 0) {
-						fprintf(stderr, "Failed to append node in elimination\n");
-						free(coord);
-						return -1;
-					}
-					temp2 = temp2->next;
-				} while (temp2 != NULL);
-
-				/* Save node coordinates */
-				coord[l].row = i;
-				coord[l].column = j;
-				l++;
-
-				/* Subtract from counter to signal the possible candidate */
-				DPRINTF("Remaining nodes: %d", remaining_nodes);
-				--remaining_nodes;
-				DPRINTF("...%d\n", remaining_nodes);
-
-				/* If needed for the tuple, search for other candidates on the column */
-				for (k = i + 1; k < n && remaining_nodes != 0; ++k) {
-					/* Exclude adding singles to the tuple */
-					if (size_list(extended_grid[k][j]) <= 1)
-						continue;
-	
-					temp = extended_grid[k][j];
-					n_difference = count_different_values(candidates, extended_grid[k][j]);
-	
-					DPRINTF("\t\t\tCell [%d][%d] - Difference: %d\n", k + 1, j + 1, n_difference);
-	
-					if ((size_list(candidates) + n_difference) <= depth) {
-						/* Add new values to candidates */
-						DPRINTF("\t\t\tAdding new candidates to list...");
-						candidates = add_new_candidates(candidates, extended_grid[k][j]);
-						DPRINT_LIST(candidates);
-						DPRINTF("\n\n");
-	
-						coord[l].row = k;
-						coord[l].column = j;
-						l++;
-	
-						--remaining_nodes;
-						if (remaining_nodes == 0)
-							break;
-					}
-				}
-
-				if (remaining_nodes == 0) {
-					/* Found a complete naked tuple of size 'depth' */
-					DPRINTF("\nFound naked tuple of size %d at cells: ", depth);
-					for (l = 0; l < depth; ++l) {
-						DPRINTF("[%d][%d] ", coord[l].row + 1, coord[l].column + 1);
-					}
-					DPRINTF("\nValues to propagate: ");
-					DPRINT_LIST(candidates);
-					DPRINTF("\n");
-	
-					/* Propagate each value in the candidates list */
-					temp2 = candidates;
-					while (temp2 != NULL) {
-						propagate_column(
-							extended_grid, n, coord, depth,
-							temp2->data); /* Pass 'depth' as n_coordinates */
-						temp2 = temp2->next;
-					}
-	
-					/* Mark involved cells as propagated */
-					for (l = 0; l < depth; ++l) {
-						already_propagated[coord[l].row][coord[l].column] = 1;
-					}
-					changed = 1; /* Signal that at least a change occurred */
-	
-					DPRINTF("\nPropagation complete.\n\n");
-				} else {
-					/* If we didn't find enough matching nodes, this wasn't a valid tuple. */
-					DPRINTF("\t\tDid not find enough matching cells for a tuple starting at [%d][%d]\n\n",
-					       i + 1, j + 1);
-				}
-
-				/* Free the candidates list for the next iteration */
-				free_list(candidates);
+			/* Givens are singles waiting to be propagated */
+			if (grid[i][j] != 0) {
+				set_bit(mask, grid[i][j] - 1);
+				tables->singles[tables->singles_size++] = cell;
 			} else {
-				DPRINTF("\t - Cell [%d][%d] already propagated\n",
-				       i + 1, j + 1);
-				free_list(candidates); /* Free candidates if we skip due to already propagated */
+				for (value = 0; value < n; ++value)
+					set_bit(mask, value);
 			}
+
+			/* Debugging output */
+			DPRINTF("Extended grid at [%d][%d]: %d candidates\n",
+				i + 1, j + 1, count_bits(mask, words));
+
+			for (kind = 0; kind < 3; ++kind)
+				for (value = next_bit(mask, words, 0);
+				     value >= 0;
+				     value = next_bit(mask, words, value + 1))
+					set_bit(tables->positions +
+						(tables->units[cell * 3 + kind] *
+						 n + value) * words,
+						tables->slots[cell * 3 + kind]);
 		}
 	}
+}
 
-	free(coord);
-	DPRINTF("\n");
+/*
+ * Removes a candidate of a cell from the cell and the unit tables and
+ * records it on the trail. The caller checks the cell afterwards.
+ */
+static void remove_candidate(unsigned long *extended_grid,
+			     struct unit_tables *tables, int n, int cell,
+			     int value)
+{
+	unsigned long *places;
+	int words;
+	int kind;
+
+	words = tables->words;
+	clear_bit(extended_grid + cell * words, value);
+
+	/*
+	 * A pool worker only records it, on its own copy of the grid. Once
+	 * the record is full it ends its share of the pass like a
+	 * contradiction would, what it drops is found again on a later pass.
+	 */
+	if (tables->deferred != NULL) {
+		if (tables->deferred_size < tables->deferred_capacity)
+			tables->deferred[tables->deferred_size++] =
+				cell * n + value;
+		else
+			tables->contradiction = 1;
+		return;
+	}
 
-	return changed;
+	for (kind = 0; kind < 3; ++kind) {
+		places = tables->positions +
+			 (tables->units[cell * 3 + kind] * n + value) * words;
+		clear_bit(places, tables->slots[cell * 3 + kind]);
+		if (is_empty(places, words))
+			tables->contradiction = 1;
+	}
+
+	tables->trail[tables->trail_size++] = cell * n + value;
 }
 
-int naked_candidates_boxes(struct node ***extended_grid, int n,
-	int **already_propagated, int depth)
+/*
+ * Accounts the candidates just removed from a cell. Queues the cell if it
+ * is down to one value, flags it if to none.
+ */
+static void check_cell(unsigned long *extended_grid,
+		       struct unit_tables *tables, int cell, int n_removed)
 {
-	int i, j; /* Loop variables to go through the matrix */
-	int k, m; /* Temp loop variable to continue to search for matches */
-	int l; /* Loop variable to save the coordinates */
-	int remaining_nodes;
-	int changed;
-	int n_difference;
-	struct node *candidates;
-	struct node *temp;
-	struct node *temp2;
-	struct coordinates *coord;
+	unsigned long *candidates;
 
-	int sqrt_n;
-	int box_row, box_col;
-	int row_start, col_start;
-	int given_row, given_col;
+	if (tables->deferred != NULL)
+		return;
 
-	DPRINTF("\nElimination of naked candidates (box) at depth %d\n", depth);
+	tables->eliminated += n_removed;
 
-	/* Set coordinates array to lenght depth */
-	coord = (struct coordinates *)malloc(depth *
-					     sizeof(struct coordinates));
-	if (coord == NULL) {
-		fprintf(stderr, "Memory allocation failed\n");
-		return -1; /* Indicate error */
+	candidates = extended_grid + cell * tables->words;
+	if (is_empty(candidates, tables->words)) {
+		tables->contradiction = 1;
+	} else if (is_single(candidates, tables->words)) {
+		tables->singles[tables->singles_size++] = cell;
+		++tables->resolved;
 	}
+}
 
-	sqrt_n = (int)sqrt(n);
-	changed = 0; /* Set changed to 0, since nothing changed yet */
-
-	for (box_row = 0; box_row < sqrt_n; ++box_row) {
-		for (box_col = 0; box_col < sqrt_n; ++box_col) {
-			/* Calculate starting row and column for the current box */
-			row_start = box_row * sqrt_n;
-			col_start = box_col * sqrt_n;
-
-			/* Iterate through the cells within the box */
-			for (i = row_start; i < row_start + sqrt_n; ++i) {
-                		for (j = col_start; j < col_start + sqrt_n; ++j) {
-					remaining_nodes = depth;
-					candidates = NULL; /* Reset candidates list for each potential starting node */
-					l = 0; /* Reset coordinate index for each potential starting node 'i' */
-
-					temp = extended_grid[i][j];
-					DPRINTF("\tAt cell [%d][%d]: ", i + 1, j + 1);
-					DPRINT_LIST(temp);
-					DPRINTF("\n");
-
-					if (temp == NULL) {
-						DPRINTF("\t\t - No values in this cell\n");
-						continue;
-					}
-
-					/* Check the right depth */
-					if (size_list(temp) > depth) {
-						DPRINTF("\t\t - More than %d values in this cell\n",
-						depth);
-						continue;
-					}
-
-					/* Exclude naked singles for superior tuples */
-					if (size_list(temp) == 1 && depth > 1)
-						continue;
-
-					/* If we are in this section of the code it means we found something with a good depth */
-					DPRINTF("\t\tRight number of values\n");
-
-					/* Check if already propagated */
-					if (!already_propagated[i][j]) {
-						/* Append values in candidate list */
-						temp2 = temp;
-						do {
-							candidates = append(candidates, temp2->data);
-							if (candidates == NULL && temp2->data != 0) {
-								fprintf(stderr, "Failed to append node in elimination\n");
-								free(coord);
-								return -1;
-							}
-							temp2 = temp2->next;
-						} while (temp2 != NULL);
-
-						/* Save node coordinates */
-						coord[l].row = i;
-						coord[l].column = j;
-						l++;
-
-						/* Subtract from counter to signal the possible candidate */
-						DPRINTF("Remaining nodes: %d", remaining_nodes);
-						--remaining_nodes;
-						DPRINTF("...%d\n", remaining_nodes);
-
-						given_row = i;
-						given_col = j;
-						/* If needed for the tuple, search for other candidates on the box */
-						for (k = row_start; k < row_start + sqrt_n && remaining_nodes != 0; ++k) {
-							for (m = col_start; m < col_start + sqrt_n; ++m) {
-								/* Condition to operate only on values after */
-								if (k > given_row || (k == given_row && m > given_col)) {
-									/* Exclude adding singles to the tuple */
-									if (size_list(extended_grid[k][m]) <= 1)
-										continue;
-				
-									temp = extended_grid[k][m];
-									n_difference = count_different_values(candidates, extended_grid[k][m]);
-					
-									DPRINTF("\t\t\tCell [%d][%d] - Difference: %d\n", k + 1, m + 1, n_difference);
-					
-									if ((size_list(candidates) + n_difference) <= depth) {
-										/* Add new values to candidates */
-										DPRINTF("\t\t\tAdding new candidates to list...");
-										candidates = add_new_candidates(candidates, extended_grid[k][m]);
-										DPRINT_LIST(candidates);
-										DPRINTF("\n\n");
-					
-										coord[l].row = k;
-										coord[l].column = m;
-										l++;
-					
-										--remaining_nodes;
-										if (remaining_nodes == 0)
-											break;
-									}
-								}
-
-							}
-
-							if (remaining_nodes == 0)
-								break;
-						}
-
-						if (remaining_nodes == 0) {
-							/* Found a complete naked tuple of size 'depth' */
-							DPRINTF("\nFound naked tuple of size %d at cells: ", depth);
-							for (l = 0; l < depth; ++l) {
-								DPRINTF("[%d][%d] ", coord[l].row + 1, coord[l].column + 1);
-							}
-							DPRINTF("\nValues to propagate: ");
-							DPRINT_LIST(candidates);
-							DPRINTF("\n");
-			
-							/* Propagate each value in the candidates list */
-							temp2 = candidates;
-							while (temp2 != NULL) {
-								propagate_box(
-									extended_grid, n, coord, depth,
-									temp2->data); /* Pass 'depth' as n_coordinates */
-								temp2 = temp2->next;
-							}
-			
-							/* Mark involved cells as propagated */
-							for (l = 0; l < depth; ++l) {
-								already_propagated[coord[l].row][coord[l].column] = 1;
-							}
-							changed = 1; /* Signal that at least a change occurred */
-			
-							DPRINTF("\nPropagation complete.\n\n");
-						} else {
-							/* If we didn't find enough matching nodes, this wasn't a valid tuple. */
-							DPRINTF("\t\tDid not find enough matching cells for a tuple starting at [%d][%d]\n\n",
-							i + 1, j + 1);
-						}
-
-						/* Free the candidates list for the next iteration */
-						free_list(candidates);
-					} else {
-						DPRINTF("\t - Cell [%d][%d] already propagated\n",
-						i + 1, j + 1);
-						free_list(candidates); /* Free candidates if we skip due to already propagated */
-					}
-				}
-			}
-		}
+int eliminate_candidates(unsigned long *extended_grid,
+			 struct unit_tables *tables, int n, int cell,
+			 const unsigned long *mask)
+{
+	unsigned long *candidates;
+	int n_removed;
+	int value;
+	int words;
+
+	words = tables->words;
+	candidates = extended_grid + cell * words;
+
+	n_removed = 0;
+	for (value = next_bit(candidates, words, 0); value >= 0;
+	     value = next_bit(candidates, words, value + 1)) {
+		if (!test_bit(mask, value))
+			continue;
+		remove_candidate(extended_grid, tables, n, cell, value);
+		++n_removed;
 	}
 
-	free(coord);
-	DPRINTF("\n");
+	/* Nothing to do if none of the values was still a candidate */
+	if (n_removed > 0)
+		check_cell(extended_grid, tables, cell, n_removed);
 
-	return changed;
+	return n_removed;
 }
 
-void propagate_row(struct node ***extended_grid, int n,
-		   struct coordinates *coord, int n_coordinates, int value)
+/*
+ * Removes a single value from a cell.
+ */
+static int eliminate_value(unsigned long *extended_grid,
+			   struct unit_tables *tables, int n, int cell,
+			   int value)
 {
-	int i, j;
-	int row =
-		coord[0].row; /* Propagating only the row, the value will be same for all coords */
-	int skip;
+	if (!test_bit(extended_grid + cell * tables->words, value))
+		return 0;
 
-	DPRINTF("\nPropagating value %d on row %d\n", value, row + 1);
+	remove_candidate(extended_grid, tables, n, cell, value);
+	check_cell(extended_grid, tables, cell, 1);
+	return 1;
+}
 
-	for (i = 0; i < n; ++i) {
-		skip = 0; /* Flag to check if current cell [row][i] should be skipped */
-		for (j = 0; j < n_coordinates; ++j) {
-			/* Check if the current column index 'i' matches any of the coordinate columns */
-			if (i == coord[j].column) {
-				skip = 1; /* Mark this cell to be skipped */
-				break; /* No need to check further coordinates for this cell */
-			}
-		}
+int apply_deferred(unsigned long *extended_grid, struct unit_tables *tables,
+		   int n, const int *deferred, int size)
+{
+	int i; /* Loop variable */
+	int n_removed;
 
-		/* If the cell should not be skipped, proceed with deletion */
-		if (!skip) {
-			extended_grid[row][i] = delete_at_given_value(
-				extended_grid[row][i], value);
-		}
+	n_removed = 0;
+	for (i = 0; i < size && !tables->contradiction; ++i)
+		n_removed += eliminate_value(extended_grid, tables, n,
+					     deferred[i] / n, deferred[i] % n);
+
+	return n_removed;
+}
+
+/*
+ * Removes every candidate of a cell outside a bitset.
+ */
+static int keep_candidates(unsigned long *extended_grid,
+			   struct unit_tables *tables, int n, int cell,
+			   const unsigned long *keep)
+{
+	unsigned long *candidates;
+	int n_removed;
+	int other;
+	int words;
+
+	words = tables->words;
+	candidates = extended_grid + cell * words;
+
+	n_removed = 0;
+	for (other = next_bit(candidates, words, 0); other >= 0;
+	     other = next_bit(candidates, words, other + 1)) {
+		if (test_bit(keep, other))
+			continue;
+		remove_candidate(extended_grid, tables, n, cell, other);
+		++n_removed;
 	}
+
+	if (n_removed > 0)
+		check_cell(extended_grid, tables, cell, n_removed);
+
+	return n_removed;
 }
 
-void propagate_column(struct node ***extended_grid, int n,
-	struct coordinates *coord, int n_coordinates, int value)
+/* Places value in a cell */
+static int keep_value(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n, int cell, int value)
 {
-	int i, j;
-	int column =
-		coord[0].column; /* Propagating only the column, the value will be same for all coords */
-	int skip;
+	memset(tables->members, 0, tables->words * sizeof(unsigned long));
+	set_bit(tables->members, value);
+	return keep_candidates(extended_grid, tables, n, cell,
+			       tables->members);
+}
 
-	DPRINTF("\nPropagating value %d on column %d\n", value, column + 1);
+void undo_eliminations(unsigned long *extended_grid,
+		       struct unit_tables *tables, int n, int mark)
+{
+	int entry;
+	int cell;
+	int value;
+	int kind;
+	int words;
+
+	/*
+	 * The state at the mark was a fixpoint: no contradiction and no
+	 * single left to propagate.
+	 */
+	tables->contradiction = 0;
+	tables->singles_size = 0;
+
+	words = tables->words;
+	while (tables->trail_size > mark) {
+		entry = tables->trail[--tables->trail_size];
+		cell = entry / n;
+		value = entry % n;
+
+		set_bit(extended_grid + cell * words, value);
+		for (kind = 0; kind < 3; ++kind)
+			set_bit(tables->positions +
+				(tables->units[cell * 3 + kind] * n + value) *
+					words,
+				tables->slots[cell * 3 + kind]);
+	}
+}
 
-	for (i = 0; i < n; ++i) {
-		skip = 0; /* Flag to check if current cell [i][column] should be skipped */
-		for (j = 0; j < n_coordinates; ++j) {
-			/* Check if the current row index 'i' matches any of the coordinate rows */
-			if (i == coord[j].row) {
-				skip = 1; /* Mark this cell to be skipped */
-				break; /* No need to check further coordinates for this cell */
+/*
+ * Whether the subset being searched already holds a slot, a value or a
+ * line: the first size entries of the stack.
+ */
+static int in_subset(const struct unit_tables *tables, int size, int member)
+{
+	int k; /* Loop variable */
+
+	for (k = 0; k < size; ++k)
+		if (tables->stack[k] == member)
+			return 1;
+	return 0;
+}
+
+/*
+ * Depth-first enumeration of the subsets of the unresolved cells of a unit,
+ * pruned as soon as the union of their candidates grows past the limit.
+ * A subset of k cells whose union holds exactly k values is a naked tuple:
+ * those values are removed from every other unresolved cell of the unit.
+ * The slots of the first size cells are on the stack and the union of
+ * their candidates is unions[size].
+ */
+static int search_naked_subsets(unsigned long *extended_grid,
+				struct unit_tables *tables, int n, int unit,
+				const int *free_slots, int n_free, int start,
+				int size, int limit)
+{
+	int i, k; /* Loop variables */
+	int changed;
+	int cell;
+	int count;
+	int words;
+	int removed;
+	unsigned long *mask;
+	unsigned long *merged;
+	struct tuple_stats *stats;
+
+	words = tables->words;
+	merged = tables->unions + (size + 1) * words;
+	stats = tuple_sample(tables, PROFILE_NAKED, size + 1);
+	changed = 0;
+	for (i = start; i < n_free; ++i) {
+		cell = tables->cells[unit * n + free_slots[i]];
+		mask = extended_grid + cell * words;
+
+		/* Skip cells resolved while searching */
+		if (!is_several(mask, words))
+			continue;
+
+		merge_bits(merged, tables->unions + size * words, mask, words);
+		count = count_bits(merged, words);
+		if (stats != NULL)
+			++stats->subsets;
+		if (count > limit)
+			continue;
+
+		tables->stack[size] = free_slots[i];
+		if (count == size + 1 && size + 1 > 1) {
+			DPRINTF("\tFound naked tuple of size %d in unit %d\n",
+				size + 1, unit);
+
+			/* Remove its values from the rest of the unit */
+			removed = 0;
+			for (k = 0; k < n_free; ++k) {
+				if (in_subset(tables, size + 1, free_slots[k]))
+					continue;
+
+				removed += eliminate_candidates(extended_grid,
+					tables, n,
+					tables->cells[unit * n + free_slots[k]],
+					merged);
+			}
+			if (stats != NULL) {
+				++stats->tuples;
+				stats->eliminations += removed;
 			}
+			changed += removed;
+			continue;
 		}
 
-		/* If the cell should not be skipped, proceed with deletion */
-		if (!skip) {
-			extended_grid[i][column] = delete_at_given_value(
-				extended_grid[i][column], value);
+		if (size + 1 < limit)
+			changed += search_naked_subsets(extended_grid, tables, n,
+				unit, free_slots, n_free, i + 1, size + 1,
+				limit);
+	}
+
+	return changed;
+}
+
+/*
+ * Naked singles: the value of a cell left with a single candidate is
+ * removed from the rest of its row, column and box. Only the cells queued
+ * by eliminate_candidates() since the last pass are looked at.
+ */
+int naked_singles(unsigned long *extended_grid, struct unit_tables *tables,
+		  int n)
+{
+	int kind;
+	int cell;
+	int unit;
+	int slot;
+	int other;
+	int value;
+	int changed;
+	int words;
+	unsigned long *others;
+
+	words = tables->words;
+	changed = 0;
+	while (tables->singles_size > 0 && !tables->contradiction) {
+		cell = tables->singles[--tables->singles_size];
+		value = next_bit(extended_grid + cell * words, words, 0);
+
+		for (kind = 0; kind < 3; ++kind) {
+			unit = tables->units[cell * 3 + kind];
+			slot = tables->slots[cell * 3 + kind];
+			others = tables->positions + (unit * n + value) * words;
+			for (other = next_bit(others, words, 0); other >= 0;
+			     other = next_bit(others, words, other + 1))
+				if (other != slot)
+					changed += eliminate_value(extended_grid,
+						tables, n,
+						tables->cells[unit * n + other],
+						value);
 		}
 	}
+
+	return changed;
 }
 
-void propagate_box(struct node ***extended_grid, int n,
-	struct coordinates *coord, int n_coordinates, int value)
+int naked_candidates(unsigned long *extended_grid, struct unit_tables *tables,
+		     int n, int unit)
 {
-	int i, j;
-	int k;
-	int sqrt_n;
-	int skip;
+	int slot;
+	int changed;
+	int n_free;
+	int limit;
+	int words;
+	int *free_slots;
+
+	DPRINTF("\nElimination of naked candidates in unit %d\n", unit);
+
+	words = tables->words;
+	free_slots = tables->scratch;
+
+	/* Cells of the unit that are not resolved yet */
+	n_free = 0;
+	for (slot = 0; slot < n; ++slot)
+		if (is_several(extended_grid +
+			       tables->cells[unit * n + slot] * words,
+			       words))
+			free_slots[n_free++] = slot;
+
+	/*
+	 * Tuples of two cells or more, singles are handled by
+	 * naked_singles(). A naked tuple of more than half of the unresolved
+	 * cells is the complement of a smaller hidden tuple, which the hidden
+	 * candidates search finds anyway, so n_free / 2 cells are enough.
+	 */
+	changed = 0;
+	limit = n_free / 2 < MAX_TUPLE_SIZE ? n_free / 2 : MAX_TUPLE_SIZE;
+	if (limit >= 2) {
+		memset(tables->unions, 0, words * sizeof(unsigned long));
+		changed = search_naked_subsets(extended_grid, tables, n, unit,
+					       free_slots, n_free, 0, 0, limit);
+	}
 
-	int row_start, col_start;
+	return changed;
+}
 
-	sqrt_n = (int)sqrt(n);
-	row_start = (coord[0].row / sqrt_n) * sqrt_n;
-        col_start = (coord[0].column / sqrt_n) * sqrt_n; 
+/*
+ * Removes a value from the cells of a unit selected by a slot bitset,
+ * except from those of a second one.
+ */
+static int eliminate_from_unit(unsigned long *extended_grid,
+			       struct unit_tables *tables, int n, int unit,
+			       const unsigned long *slots,
+			       const unsigned long *except, int value)
+{
+	int changed;
+	int slot;
+	int words;
 
-	DPRINTF("\nPropagating value %d in its box\n", value);
+	words = tables->words;
+	changed = 0;
+	for (slot = next_bit(slots, words, 0); slot >= 0;
+	     slot = next_bit(slots, words, slot + 1))
+		if (!test_bit(except, slot))
+			changed += eliminate_value(extended_grid, tables, n,
+				tables->cells[unit * n + slot], value);
 
-	for (i = row_start; i < row_start + sqrt_n; ++i) {
-		for (j = col_start; j < col_start + sqrt_n; ++j) {
-			skip = 0;
+	return changed;
+}
 
-			for (k = 0; k < n_coordinates; ++k) {
-				if (i == coord[k].row && j == coord[k].column) {
-					skip = 1;
-					break;
-				}
-			}
+/*
+ * Box-line intersections. If all the places of a value in a box lie on one
+ * row or column (pointing), the value is removed from the rest of that
+ * line. If all its places on a row or column crossing the box lie inside
+ * the box (claiming), it is removed from the rest of the box.
+ */
+int intersection_removal(unsigned long *extended_grid,
+			 struct unit_tables *tables, int n, int box)
+{
+	int k; /* Loop variable */
+	int value;
+	int changed;
+	int sqrt_n;
+	int words;
+	int box_row, box_col;
+	int row_unit, col_unit, box_unit;
+	unsigned long *places;
+	unsigned long *row_places, *col_places;
+	unsigned long *box_row_slots, *box_col_slots;
+	unsigned long *row_segment, *col_segment;
+
+	sqrt_n = tables->sqrt_n;
+	words = tables->words;
+	box_row = box / sqrt_n;
+	box_col = box % sqrt_n;
+	box_unit = 2 * n + box;
+	row_segment = tables->segments + box_col * words;
+	col_segment = tables->segments + box_row * words;
+	changed = 0;
+
+	for (value = 0; value < n; ++value) {
+		places = tables->positions + (box_unit * n + value) * words;
+
+		for (k = 0; k < sqrt_n; ++k) {
+			row_unit = box_row * sqrt_n + k;
+			col_unit = n + box_col * sqrt_n + k;
+			row_places = tables->positions +
+				     (row_unit * n + value) * words;
+			col_places = tables->positions +
+				     (col_unit * n + value) * words;
+			box_row_slots = tables->box_rows + k * words;
+			box_col_slots = tables->box_columns + k * words;
+
+			/*
+			 * Pointing along the k-th row and column of the box.
+			 * Each test ends by checking that there is something
+			 * to remove, there rarely is.
+			 */
+			if (!is_empty(places, words) &&
+			    is_subset(places, box_row_slots, words) &&
+			    !is_subset(row_places, row_segment, words))
+				changed += eliminate_from_unit(extended_grid,
+					tables, n, row_unit, row_places,
+					row_segment, value);
+			if (!is_empty(places, words) &&
+			    is_subset(places, box_col_slots, words) &&
+			    !is_subset(col_places, col_segment, words))
+				changed += eliminate_from_unit(extended_grid,
+					tables, n, col_unit, col_places,
+					col_segment, value);
+
+			/* Claiming by the k-th row and column of the box */
+			if (!is_empty(row_places, words) &&
+			    is_subset(row_places, row_segment, words) &&
+			    !is_subset(places, box_row_slots, words))
+				changed += eliminate_from_unit(extended_grid,
+					tables, n, box_unit, places,
+					box_row_slots, value);
+			if (!is_empty(col_places, words) &&
+			    is_subset(col_places, col_segment, words) &&
+			    !is_subset(places, box_col_slots, words))
+				changed += eliminate_from_unit(extended_grid,
+					tables, n, box_unit, places,
+					box_col_slots, value);
+		}
+	}
 
-			if (!skip) {
-				extended_grid[i][j] = delete_at_given_value(extended_grid[i][j], value);
+	return changed;
+}
+
+/*
+ * Same enumeration as for naked subsets, but over the position bitsets of
+ * the values still to be placed in the unit. When k values fit in exactly
+ * k cells those cells can hold nothing else, so all other candidates are
+ * removed from them.
+ */
+static int search_hidden_subsets(unsigned long *extended_grid,
+				 struct unit_tables *tables, int n, int unit,
+				 const int *free_values, int n_free, int start,
+				 int size, int limit)
+{
+	int i, k; /* Loop variables */
+	int changed;
+	int slot;
+	int count;
+	int words;
+	int removed;
+	unsigned long *mask;
+	unsigned long *merged;
+	struct tuple_stats *stats;
+
+	words = tables->words;
+	merged = tables->unions + (size + 1) * words;
+	stats = tuple_sample(tables, PROFILE_HIDDEN, size + 1);
+	changed = 0;
+	for (i = start; i < n_free; ++i) {
+		mask = tables->positions + (unit * n + free_values[i]) * words;
+
+		/* Skip values placed while searching */
+		if (!is_several(mask, words))
+			continue;
+
+		merge_bits(merged, tables->unions + size * words, mask, words);
+		count = count_bits(merged, words);
+		if (stats != NULL)
+			++stats->subsets;
+		if (count > limit)
+			continue;
+
+		tables->stack[size] = free_values[i];
+		if (count == size + 1 && size + 1 > 1) {
+			DPRINTF("\tFound hidden tuple of size %d in unit %d\n",
+				size + 1, unit);
+
+			/* Keep only its values in the cells it covers */
+			memset(tables->members, 0,
+			       words * sizeof(unsigned long));
+			for (k = 0; k <= size; ++k)
+				set_bit(tables->members, tables->stack[k]);
+
+			removed = 0;
+			for (slot = next_bit(merged, words, 0); slot >= 0;
+			     slot = next_bit(merged, words, slot + 1))
+				removed += keep_candidates(extended_grid,
+					tables, n,
+					tables->cells[unit * n + slot],
+					tables->members);
+			if (stats != NULL) {
+				++stats->tuples;
+				stats->eliminations += removed;
 			}
+			changed += removed;
+			continue;
 		}
+
+		if (size + 1 < limit)
+			changed += search_hidden_subsets(extended_grid, tables, n,
+				unit, free_values, n_free, i + 1, size + 1,
+				limit);
 	}
+
+	return changed;
 }
 
-int hidden_singles(struct node ***extended_grid, int n)
+int hidden_candidates(unsigned long *extended_grid,
+		      struct unit_tables *tables, int n, int unit)
 {
-	int is_changed;
-	int i, j; /* Loop variables */
-	int flag;
 	int value;
+	int changed;
+	int n_free;
+	int limit;
+	int words;
+	int *free_values;
+
+	DPRINTF("\nElimination of hidden candidates in unit %d\n", unit);
+
+	words = tables->words;
+	free_values = tables->scratch;
+
+	/* Values that still have more than one place in the unit */
+	n_free = 0;
+	for (value = 0; value < n; ++value)
+		if (is_several(tables->positions + (unit * n + value) * words,
+			       words))
+			free_values[n_free++] = value;
+
+	/* Bigger tuples are complements of naked ones, see above */
+	changed = 0;
+	limit = n_free / 2 < MAX_TUPLE_SIZE ? n_free / 2 : MAX_TUPLE_SIZE;
+	if (limit >= 2) {
+		memset(tables->unions, 0, words * sizeof(unsigned long));
+		changed = search_hidden_subsets(extended_grid, tables, n, unit,
+						free_values, n_free, 0, 0,
+						limit);
+	}
 
-	is_changed = 0;
-
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			struct node *temp = extended_grid[i][j];
-
-			/* If already a single value, go to next cell */
-			if (temp->next == NULL) {
-				DPRINTF("\tAt [%d][%d] already a single value: %d\n",
-				       i + 1, j + 1, temp->data);
-				continue;
-			}
+	return changed;
+}
 
-			/* Traverse every node of the list looking if it's a hidden single */
-			flag = 0;
-			while (temp != NULL) {
-				value = temp->data;
-				DPRINTF("\tAt [%d][%d] - checking value %d\n",
-				       i + 1, j + 1, value);
-
-				flag = check_hidden_single(extended_grid, n, i,
-							   j, value);
-
-				if (!flag) {
-					DPRINTF("\t - Value %d is a hidden single\n",
-					       value);
-					break;
-				} else {
-					DPRINTF("\t - Copy found, value %d is not a hidden single, going to next node\n",
-					       value);
-				}
-
-				temp = temp->next;
-			}
+/*
+ * All-different matching. The cells of a unit must take n distinct values,
+ * so every solution matches the unit's slots to its values along the
+ * candidates. Following Regin, a candidate is kept only if some perfect
+ * matching uses it: given one matching, that is the matched candidates and
+ * those whose slot and matched slot sit in the same strongly connected
+ * component of the graph where slot s points to slot t when s still allows
+ * the value matched to t. This removes what naked and hidden tuples of any
+ * size would, in time linear in the candidates of the unit.
+ */
+struct matching_graph {
+	unsigned long *extended_grid;
+	const int *cells;	/* Cell of each slot of the unit */
+	int *matching;		/* Value matched to each slot */
+	int *slot_of;		/* Slot matched to each value */
+	int *visited;		/* Values seen by the augmenting search */
+	int *order;		/* Visit order of each slot, -1 if not yet */
+	int *low;		/* Lowest order reachable from each slot */
+	int *component;		/* Component of each slot, -1 while open */
+	int *stack;		/* Slots visited but not in a component yet */
+	int stack_size;
+	int visits;
+	int components;
+	int words;
+};
+
+/*
+ * Augmenting path search: matches a slot, taking its value from the slot
+ * it was matched to if that one can go elsewhere.
+ */
+static int match_slot(struct matching_graph *graph, int slot)
+{
+	const unsigned long *candidates;
+	int value;
 
-			if (!flag) {
-				struct node *temp2 = extended_grid[i][j];
-				temp2->data = value;
-				temp2 = delete_all_but_head(temp2);
+	candidates = graph->extended_grid + graph->cells[slot] * graph->words;
+	for (value = next_bit(candidates, graph->words, 0); value >= 0;
+	     value = next_bit(candidates, graph->words, value + 1)) {
+		if (graph->visited[value])
+			continue;
+		graph->visited[value] = 1;
+
+		if (graph->slot_of[value] < 0 ||
+		    match_slot(graph, graph->slot_of[value])) {
+			graph->slot_of[value] = slot;
+			graph->matching[slot] = value;
+			return 1;
+		}
+	}
 
-				is_changed = 1;
-			}
+	return 0;
+}
 
-			DPRINTF("\n");
+/*
+ * Tarjan's strongly connected components, from one slot.
+ */
+static void visit_slot(struct matching_graph *graph, int slot)
+{
+	const unsigned long *candidates;
+	int value;
+	int other;
+
+	graph->order[slot] = graph->visits;
+	graph->low[slot] = graph->visits;
+	++graph->visits;
+	graph->stack[graph->stack_size++] = slot;
+
+	candidates = graph->extended_grid + graph->cells[slot] * graph->words;
+	for (value = next_bit(candidates, graph->words, 0); value >= 0;
+	     value = next_bit(candidates, graph->words, value + 1)) {
+		if (value == graph->matching[slot])
+			continue;
+
+		other = graph->slot_of[value];
+		if (graph->order[other] < 0) {
+			visit_slot(graph, other);
+			if (graph->low[other] < graph->low[slot])
+				graph->low[slot] = graph->low[other];
+		} else if (graph->component[other] < 0 &&
+			   graph->order[other] < graph->low[slot]) {
+			graph->low[slot] = graph->order[other];
 		}
 	}
 
-	return is_changed;
+	/* The root of a component closes it */
+	if (graph->low[slot] != graph->order[slot])
+		return;
+
+	do {
+		other = graph->stack[--graph->stack_size];
+		graph->component[other] = graph->components;
+	} while (other != slot);
+	++graph->components;
 }
 
-int check_hidden_single(struct node ***extended_grid, int n, int row, int col,
-			int value)
+int all_different(unsigned long *extended_grid, struct unit_tables *tables,
+		  int n, int unit)
 {
-	int i, j; /* Loop variables */
-	int flag = 0; /* Flag to check if the value is present */
-	int box_row, box_col; /* Row and column of the box */
-	int sqrt_n; /* Square root of n */
-
-	/* Check if the value is present in the same row */
-	for (j = 0; j < n; j++) {
-		if (j != col) {
-			struct node *temp = extended_grid[row][j];
-			while (temp != NULL) {
-				if (temp->data == value) {
-					flag = 1;
-					return flag;
-				}
-				temp = temp->next;
-			}
-		}
+	struct matching_graph graph;
+	unsigned long *candidates;
+	int slot, value; /* Loop variables */
+	int changed;
+	int n_removed;
+	int cell;
+	int words;
+
+	DPRINTF("\nAll-different matching in unit %d\n", unit);
+
+	words = tables->words;
+	graph.extended_grid = extended_grid;
+	graph.cells = tables->cells + unit * n;
+	graph.matching = tables->matching + unit * n;
+	graph.slot_of = tables->graph;
+	graph.visited = graph.slot_of + n;
+	graph.order = graph.visited + n;
+	graph.low = graph.order + n;
+	graph.component = graph.low + n;
+	graph.stack = graph.component + n;
+	graph.stack_size = 0;
+	graph.visits = 0;
+	graph.components = 0;
+	graph.words = words;
+
+	/* Keep what is left of the last matching of the unit */
+	for (value = 0; value < n; ++value)
+		graph.slot_of[value] = -1;
+	for (slot = 0; slot < n; ++slot) {
+		value = graph.matching[slot];
+		if (value >= 0 &&
+		    test_bit(extended_grid + graph.cells[slot] * words, value) &&
+		    graph.slot_of[value] < 0)
+			graph.slot_of[value] = slot;
+		else
+			graph.matching[slot] = -1;
 	}
 
-	/* Check if the value is present in the same column */
-	if (!flag) {
-		for (i = 0; i < n; i++) {
-			if (i != row) {
-				struct node *temp = extended_grid[i][col];
-				while (temp != NULL) {
-					if (temp->data == value) {
-						flag = 1;
-						return flag;
-					}
-					temp = temp->next;
-				}
-			}
-		}
+	for (slot = 0; slot < n; ++slot) {
+		if (graph.matching[slot] >= 0)
+			continue;
+
+		memset(graph.visited, 0, n * sizeof(int));
+		if (match_slot(&graph, slot))
+			continue;
+
+		/*
+		 * The unit can't be completed. Emptying the cell that can't
+		 * be matched reports it, from a pool worker too.
+		 */
+		DPRINTF("\tNo value left for [%d][%d]\n",
+			graph.cells[slot] / n + 1, graph.cells[slot] % n + 1);
+		memset(tables->members, 0, words * sizeof(unsigned long));
+		return keep_candidates(extended_grid, tables, n,
+				       graph.cells[slot], tables->members);
 	}
 
-	/* Check if the value is present in the same box */
-	sqrt_n = (int)sqrt(n);
-	box_row = row - (row % sqrt_n);
-	box_col = col - (col % sqrt_n);
-
-	for (i = box_row; i < box_row + sqrt_n; i++) {
-		for (j = box_col; j < box_col + sqrt_n; j++) {
-			struct node *temp = extended_grid[i][j];
-
-			if (i != row && j != col) {
-				while (temp != NULL) {
-					if (temp->data == value) {
-						flag = 1;
-						return flag;
-					}
-					temp = temp->next;
-				}
-			}
+	for (slot = 0; slot < n; ++slot) {
+		graph.order[slot] = -1;
+		graph.component[slot] = -1;
+	}
+	for (slot = 0; slot < n; ++slot)
+		if (graph.order[slot] < 0)
+			visit_slot(&graph, slot);
+
+	/* A single component: every candidate is in some matching */
+	if (graph.components == 1)
+		return 0;
+
+	changed = 0;
+	for (slot = 0; slot < n && !tables->contradiction; ++slot) {
+		cell = graph.cells[slot];
+		candidates = extended_grid + cell * words;
+
+		memset(tables->members, 0, words * sizeof(unsigned long));
+		n_removed = 0;
+		for (value = next_bit(candidates, words, 0); value >= 0;
+		     value = next_bit(candidates, words, value + 1)) {
+			if (graph.component[graph.slot_of[value]] ==
+			    graph.component[slot])
+				continue;
+
+			DPRINTF("\tAt [%d][%d] - value %d is in no matching\n",
+				cell / n + 1, cell % n + 1, value + 1);
+			set_bit(tables->members, value);
+			++n_removed;
 		}
+
+		if (n_removed > 0)
+			changed += eliminate_candidates(extended_grid, tables,
+							n, cell,
+							tables->members);
 	}
 
-	return flag;
+	return changed;
 }
 
-void print_extended_grid(struct node ***extended_grid, int n)
+/*
+ * Enumeration of sets of base lines (rows or columns) for one value. The
+ * positions table already holds the value's row x column bit-matrix and
+ * its transpose, so the places of the value on a base line are the cover
+ * lines it meets. When k base lines meet exactly k cover lines, the value
+ * is removed from those cover lines everywhere outside the base lines.
+ */
+static int search_fish(unsigned long *extended_grid,
+		       struct unit_tables *tables, int n, int value,
+		       int base, int cover, const int *free_lines,
+		       int n_free, int start, int size, int limit)
 {
-	int i, j; /* Loop variables */
+	int i, k; /* Loop variables */
+	int changed;
+	int line;
+	int count;
+	int words;
+	unsigned long *mask;
+	unsigned long *merged;
+
+	words = tables->words;
+	merged = tables->unions + (size + 1) * words;
+	changed = 0;
+	for (i = start; i < n_free; ++i) {
+		mask = tables->positions +
+		       ((base + free_lines[i]) * n + value) * words;
+
+		/* Skip lines where the value got placed while searching */
+		if (!is_several(mask, words))
+			continue;
+
+		merge_bits(merged, tables->unions + size * words, mask, words);
+		count = count_bits(merged, words);
+		if (count > limit)
+			continue;
+
+		tables->stack[size] = free_lines[i];
+		if (count == size + 1 && size + 1 > 1) {
+			DPRINTF("\tFound fish of size %d for value %d\n",
+				size + 1, value + 1);
+
+			memset(tables->members, 0,
+			       words * sizeof(unsigned long));
+			for (k = 0; k <= size; ++k)
+				set_bit(tables->members, tables->stack[k]);
+
+			for (line = next_bit(merged, words, 0); line >= 0;
+			     line = next_bit(merged, words, line + 1))
+				changed += eliminate_from_unit(extended_grid,
+					tables, n, cover + line,
+					tables->positions +
+						((cover + line) * n + value) *
+							words,
+					tables->members, value);
+			continue;
+		}
 
-	for (i = 0; i < n; i++) {
-		for (j = 0; j < n; j++) {
-			printf("At [%d][%d]: ", i + 1, j + 1);
-			print_list(extended_grid[i][j]);
-			printf("\n");
+		if (size + 1 < limit)
+			changed += search_fish(extended_grid, tables, n, value,
+				base, cover, free_lines, n_free, i + 1,
+				size + 1, limit);
+	}
+
+	return changed;
+}
+
+int fish(unsigned long *extended_grid, struct unit_tables *tables, int n,
+	 int value, int max_size)
+{
+	int line;
+	int changed;
+	int n_free;
+	int limit;
+	int direction;
+	int base;
+	int words;
+	int *free_lines;
+
+	words = tables->words;
+	free_lines = tables->scratch;
+	changed = 0;
+
+	/* Rows as base lines first, then columns */
+	for (direction = 0; direction < 2; ++direction) {
+		base = direction * n;
+
+		/* Lines where the value still has more than one place */
+		n_free = 0;
+		for (line = 0; line < n; ++line)
+			if (is_several(tables->positions +
+				       ((base + line) * n + value) * words,
+				       words))
+				free_lines[n_free++] = line;
+
+		limit = n_free - 1 < max_size ? n_free - 1 : max_size;
+		if (limit >= 2) {
+			memset(tables->unions, 0,
+			       words * sizeof(unsigned long));
+			changed += search_fish(extended_grid, tables, n, value,
+					       base, n - base, free_lines,
+					       n_free, 0, 0, limit);
 		}
-		printf("\n");
 	}
+
+	return changed;
 }
 
-void free_extended_grid(struct node ***extended_grid, int n)
+/*
+ * Hidden singles: a value whose position bitset in a unit has exactly one
+ * bit set can only go in that cell, so every other candidate of the cell
+ * is eliminated.
+ */
+static int hidden_singles_unit(unsigned long *extended_grid,
+			       struct unit_tables *tables, int n, int unit)
 {
-	int i, j; /* Loop variables */
+	int is_changed;
+	int value; /* Loop variable */
+	int cell;
+	int words;
+	unsigned long *mask;
 
-	if (extended_grid != NULL) {
-		for (i = 0; i < n; i++) {
-			for (j = 0; j < n; j++) {
-				struct node *temp = extended_grid[i][j];
-				free_list(temp);
-			}
+	words = tables->words;
+	is_changed = 0;
 
-			free(extended_grid[i]);
-		}
+	for (value = 0; value < n; ++value) {
+		mask = tables->positions + (unit * n + value) * words;
+
+		/* Skip values with none or several positions */
+		if (!is_single(mask, words))
+			continue;
+
+		cell = tables->cells[unit * n + next_bit(mask, words, 0)];
+
+		/* Already a single value */
+		if (is_single(extended_grid + cell * words, words))
+			continue;
 
-		free(extended_grid);
+		DPRINTF("\tAt [%d][%d] - value %d is a hidden single\n",
+			cell / n + 1, cell % n + 1, value + 1);
+
+		keep_value(extended_grid, tables, n, cell, value);
+		is_changed = 1;
 	}
+
+	return is_changed;
 }
 
-void free_propagation_matrix(int ***propagation, int n)
+int hidden_singles(unsigned long *extended_grid, struct unit_tables *tables,
+		   int n)
 {
-	int i, j;
-	int sqrt_n;
+	int unit; /* Loop variable */
+	int is_changed;
 
-	sqrt_n = (int)sqrt(n);
-	for (i = 0; i < sqrt_n; ++i) {
-		for (j = 0; j < n; ++j) {
-			free(propagation[i][j]);
+	is_changed = 0;
+	for (unit = 0; unit < 3 * n; ++unit)
+		is_changed |= hidden_singles_unit(extended_grid, tables, n,
+						  unit);
+
+	return is_changed;
+}
+
+const char *technique_name(int technique)
+{
+	return technique_names[technique];
+}
+
+void print_extended_grid(unsigned long *extended_grid, int n)
+{
+	int i, j; /* Loop variables */
+	int value;
+	int words;
+	unsigned long *mask;
+
+	words = BITSET_WORDS(n);
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			printf("At [%d][%d]: ", i + 1, j + 1);
+			mask = extended_grid + (i * n + j) * words;
+			for (value = next_bit(mask, words, 0); value >= 0;
+			     value = next_bit(mask, words, value + 1))
+				printf("%d -> ", value + 1);
+			printf("\n");
 		}
-		free(propagation[i]);
+		printf("\n");
 	}
-	free(propagation);
 }
@@ -46,12 +46,30 @@ int read_grid_from_file(int **grid, FILE *file, int n)
 					i, j);
 				return -1;
 			}
+
+			/* The value becomes a bit index, 0 is an empty cell */
+			if (grid[i][j] < 0 || grid[i][j] > n) {
+				fprintf(stderr,
+					"Error: Value %d out of range at position [%d][%d]\n",
+					grid[i][j], i, j);
+				return -1;
+			}
 		}
 	}
 
 	return 0;
 }
 
+void write_grid_to_file(int **grid, FILE *file, int n)
+{
+	int i, j;
+
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
+			fprintf(file, "%d ", grid[i][j]);
+	fputc('\n', file);
+}
+
 int check_solved(int **grid, int n)
 {
 	int i, j;
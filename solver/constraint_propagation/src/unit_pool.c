@@ -0,0 +1,283 @@
+/* SPDX-License-Identifier: GPL-3.0 */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/profile.h"
+#include "../include/solver.h"
+#include "../include/unit_pool.h"
+
+struct pool_worker {
+	struct unit_pool *pool;
+	int index;		/* Takes the items index, index + n_threads... */
+	pthread_t thread;
+	struct unit_tables tables;	/* Shared tables, private scratch */
+	unsigned long *extended_grid;	/* Private copy of the candidates */
+	void *buffer;		/* Backing memory of the private arrays */
+	struct solver_profile profile;	/* Subsets of the pass, if profiled */
+};
+
+struct unit_pool {
+	int n;
+	int words;
+	int n_threads;
+	struct pool_worker *workers;	/* The caller runs the first one */
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;	/* Signaled when a pass is posted */
+	pthread_cond_t done;	/* Signaled when the last worker is done */
+	unsigned long passes;	/* Passes posted so far */
+	int running;		/* Threads still on the current one */
+	int stop;
+
+	/* The current pass */
+	unsigned long *extended_grid;
+	struct unit_tables *tables;
+	int fish_size;
+	int technique;
+};
+
+/*
+ * A worker's share of the current pass, on a fresh copy of the grid.
+ */
+static void run_share(struct unit_pool *pool, struct pool_worker *worker)
+{
+	struct unit_tables *tables;
+	int n;
+
+	n = pool->n;
+	tables = &worker->tables;
+
+	memcpy(worker->extended_grid, pool->extended_grid,
+	       n * n * pool->words * sizeof(unsigned long));
+
+	tables->contradiction = 0;
+	tables->deferred_size = 0;
+	tables->profile = pool->tables->profile != NULL ?
+			  &worker->profile : NULL;
+
+	run_technique_items(worker->extended_grid, tables, n, pool->fish_size,
+			    pool->technique, worker->index, pool->n_threads);
+}
+
+static void *unit_pool_main(void *arg)
+{
+	struct pool_worker *worker;
+	struct unit_pool *pool;
+	unsigned long seen;
+
+	worker = arg;
+	pool = worker->pool;
+	seen = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->passes == seen && !pool->stop)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		seen = pool->passes;
+		pthread_mutex_unlock(&pool->lock);
+
+		run_share(pool, worker);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->running == 0)
+			pthread_cond_signal(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/*
+ * Carves the private arrays of a worker out of one buffer: the copy of
+ * the grid, the subset unions and members, then the scratch, the stack,
+ * the matching graph, the record of removed candidates and the matching
+ * of the units.
+ */
+static int init_worker(struct unit_pool *pool, struct pool_worker *worker,
+		       const struct unit_tables *shared, int index)
+{
+	struct unit_tables *tables;
+	size_t n_masks, n_ints;
+	int n, words;
+	int i; /* Loop variable */
+
+	n = pool->n;
+	words = pool->words;
+
+	n_masks = (size_t)(n * n + n + 2) * words;
+	n_ints = (size_t)(8 * n + 4 * n * n);
+	worker->buffer = malloc(n_masks * sizeof(unsigned long) +
+				n_ints * sizeof(int));
+	if (worker->buffer == NULL)
+		return -1;
+
+	worker->pool = pool;
+	worker->index = index;
+	worker->extended_grid = worker->buffer;
+
+	tables = &worker->tables;
+	*tables = *shared;
+	tables->unions = worker->extended_grid + n * n * words;
+	tables->members = tables->unions + (n + 1) * words;
+	tables->scratch = (int *)(tables->members + words);
+	tables->stack = tables->scratch + n;
+	tables->graph = tables->stack + n;
+	tables->deferred = tables->graph + 6 * n;
+	tables->deferred_size = 0;
+	tables->deferred_capacity = n * n;
+
+	/* A worker always gets the same units, so it keeps their matching */
+	tables->matching = tables->deferred + n * n;
+	for (i = 0; i < 3 * n * n; ++i)
+		tables->matching[i] = -1;
+
+	/* The shared per-solve state is off limits */
+	tables->singles = NULL;
+	tables->trail = NULL;
+	tables->profile = NULL;
+	tables->pool = NULL;
+
+	return 0;
+}
+
+struct unit_pool *create_unit_pool(struct solver_context *context,
+				   int n_threads)
+{
+	struct unit_pool *pool;
+	int n_started;
+	int i; /* Loop variable */
+
+	if (n_threads < 1)
+		return NULL;
+
+	pool = malloc(sizeof(*pool));
+	if (pool == NULL)
+		return NULL;
+
+	pool->n = context->n;
+	pool->words = context->tables.words;
+	pool->n_threads = n_threads;
+	pool->passes = 0;
+	pool->running = 0;
+	pool->stop = 0;
+
+	pool->workers = calloc(n_threads, sizeof(*pool->workers));
+	if (pool->workers == NULL) {
+		free(pool);
+		return NULL;
+	}
+
+	for (i = 0; i < n_threads; ++i) {
+		if (init_worker(pool, &pool->workers[i], &context->tables,
+				i) != 0)
+			break;
+	}
+
+	if (i < n_threads) {
+		for (i = 0; i < n_threads; ++i)
+			free(pool->workers[i].buffer);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	/* The first worker is the caller of unit_pool_run() */
+	for (n_started = 1; n_started < n_threads; ++n_started)
+		if (pthread_create(&pool->workers[n_started].thread, NULL,
+				   unit_pool_main,
+				   &pool->workers[n_started]) != 0)
+			break;
+
+	if (n_started < n_threads) {
+		for (i = n_started; i < n_threads; ++i)
+			free(pool->workers[i].buffer);
+		pool->n_threads = n_started;
+		free_unit_pool(pool);
+		return NULL;
+	}
+
+	context->tables.pool = pool;
+	return pool;
+}
+
+void free_unit_pool(struct unit_pool *pool)
+{
+	int i; /* Loop variable */
+
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 1; i < pool->n_threads; ++i)
+		pthread_join(pool->workers[i].thread, NULL);
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+
+	for (i = 0; i < pool->n_threads; ++i)
+		free(pool->workers[i].buffer);
+	free(pool->workers);
+	free(pool);
+}
+
+int unit_pool_run(struct unit_pool *pool, unsigned long *extended_grid,
+		  struct unit_tables *tables, int n, int fish_size,
+		  int technique)
+{
+	struct pool_worker *worker;
+	int n_removed;
+	int i; /* Loop variable */
+
+	pthread_mutex_lock(&pool->lock);
+	pool->extended_grid = extended_grid;
+	pool->tables = tables;
+	pool->fish_size = fish_size;
+	pool->technique = technique;
+	pool->running = pool->n_threads - 1;
+	++pool->passes;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_share(pool, &pool->workers[0]);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->running > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	/* Nothing was written during the pass, apply it all now */
+	n_removed = 0;
+	for (i = 0; i < pool->n_threads && !tables->contradiction; ++i) {
+		worker = &pool->workers[i];
+		n_removed += apply_deferred(extended_grid, tables, n,
+					    worker->tables.deferred,
+					    worker->tables.deferred_size);
+	}
+
+	if (tables->profile != NULL) {
+		for (i = 0; i < pool->n_threads; ++i) {
+			worker = &pool->workers[i];
+			profile_merge_tuples(tables->profile,
+					     &worker->profile);
+			memset(worker->profile.tuples, 0,
+			       sizeof(worker->profile.tuples));
+		}
+	}
+
+	return n_removed;
+}